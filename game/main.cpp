@@ -1,17 +1,189 @@
  #include "src/game.hpp"
+#include "src/host.hpp"
+#include "src/scenarios.hpp"
+#include "src/allocations.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+
+// Count every allocation, so the overlay can show allocations per frame
+void *operator new(std::size_t size)
+{
+    Allocations::record(size);
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// Over-aligned types, like the host's per core workers, are allocated through the aligned overloads
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    Allocations::record(size);
+    auto alignment = static_cast<std::size_t>(align);
+#if defined(_WIN32)
+    void *ptr = _aligned_malloc(size ? size : 1, alignment);
+#else
+    // The size has to be a multiple of the alignment
+    auto alignedSize = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+    void *ptr = std::aligned_alloc(alignment, alignedSize);
+#endif
+    if (ptr)
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t align) noexcept
+{
+    operator delete(ptr, align);
+}
+
+PacingMode parsePacingMode(std::string_view mode)
+{
+    if (mode == "uncapped")
+        return PacingMode::UNCAPPED;
+    if (mode == "vsync")
+        return PacingMode::VSYNC;
+    if (mode != "fixed")
+        PRINT("UNKNOWN PACING MODE:", mode, ", PACING FIXED INSTEAD")
+
+    return PacingMode::FIXED;
+}
+
+HostSchedule parseHostSchedule(std::string_view schedule)
+{
+    if (schedule == "round-robin")
+        return HostSchedule::ROUND_ROBIN;
+    if (schedule != "work-stealing")
+        PRINT("UNKNOWN HOST SCHEDULE:", schedule, ", WORK STEALING INSTEAD")
+
+    return HostSchedule::WORK_STEALING;
+}
+
+/**
+ * @brief Read run options from the command line
+ *
+ * @param argc - argument count
+ * @param argv - arguments
+ */
+RunConfig parseArgs(int argc, char **argv)
+{
+    RunConfig config{};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg{argv[i]};
+        bool hasValue = i + 1 < argc;
+        if (arg == "--render-thread")
+            config.renderThread = true;
+        else if (arg == "--headless")
+            config.headless = true;
+        else if (arg == "--capture" && hasValue)
+            config.captureDir = argv[++i];
+        else if (arg == "--capture-interval" && hasValue)
+            config.captureInterval = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--capture-ppm")
+            config.capturePPM = true;
+        else if (arg == "--autopilot")
+            config.autopilot = true;
+        else if (arg == "--pacing" && hasValue)
+            config.pacing = parsePacingMode(argv[++i]);
+        else if (arg == "--fps" && hasValue)
+            config.fps = std::atoi(argv[++i]);
+        else if (arg == "--sim-step" && hasValue)
+            config.simStep = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        else if (arg == "--fused-combat")
+            config.fusedCombat = true;
+        else if (arg == "--trace" && hasValue)
+            config.traceFile = argv[++i];
+        else if (arg == "--telemetry" && hasValue)
+            config.telemetryFile = argv[++i];
+        else if (arg == "--telemetry-card")
+            config.telemetryCard = true;
+        else if (arg == "--overlay")
+            config.overlay = true;
+        else if (arg == "--snapshot" && hasValue)
+            config.snapshotFile = argv[++i];
+        else if (arg == "--load-snapshot")
+            config.loadSnapshot = true;
+        else if (arg == "--save-snapshot-at" && hasValue)
+            config.saveSnapshotAt = std::atoi(argv[++i]);
+        else if (arg == "--rollback" && hasValue)
+            config.rollbackDepth = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--hash")
+            config.hashState = true;
+        else if (arg == "--hash-log" && hasValue)
+            config.hashLog = argv[++i];
+        else if (arg == "--hash-compare" && hasValue)
+            config.hashReference = argv[++i];
+        else if (arg == "--stage" && hasValue)
+            config.startStage = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--players" && hasValue)
+            config.players = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--endless")
+            config.endless = true;
+        else if (arg == "--wave-seed" && hasValue)
+            config.waveSeed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--wave-density" && hasValue)
+            config.waveDensity = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--wave-hives" && hasValue)
+            config.waveHives = std::atoi(argv[++i]);
+        else if (arg == "--loopback")
+            config.loopback = true;
+        else if (arg == "--tick-rate" && hasValue)
+            config.tickRate = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--host" && hasValue)
+            config.hostSessions = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--host-threads" && hasValue)
+            config.hostThreads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--host-schedule" && hasValue)
+            config.hostSchedule = parseHostSchedule(argv[++i]);
+        else if (arg == "--scenario" && hasValue)
+            config.scenario = argv[++i];
+        else if (arg == "--scenario-scale" && hasValue)
+            config.scenarioScale = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        else if (arg == "--frames" && hasValue)
+            config.frames = std::atoi(argv[++i]);
+        else
+            PRINT("UNKNOWN ARGUMENT:", arg)
+    }
+
+    return config;
+}
 
 /** 
  * @brief Run benchmarks for the specified number of sets and frames
  *
+ * @param config - run options
  * @param sets - number of sets to run
  * @param frames - frame limit. Stops the game when the limit is reached
  */
-Benchmark runWithBenchmarks(int sets = 3, int frames = 500000)
+Benchmark runWithBenchmarks(RunConfig config, int sets = 3, int frames = 500000)
 {
     std::vector<Benchmark> benchmarks{};
     for (int i = 0; i < sets; ++i)
     {
-        Game game{};
+        Game game{config};
         benchmarks.push_back(game.run(frames));
     }
 
@@ -28,17 +200,35 @@ Benchmark runWithBenchmarks(int sets = 3, int frames = 500000)
     return benches;
 }
 
-int main() {
+int main(int argc, char **argv) {
+    RunConfig config = parseArgs(argc, argv);
+    if (!config.scenario.empty())
+    {
+        Scenarios::Bench bench{config};
+        bench.run();
+        bench.printReport();
+        return 0;
+    }
+    if (config.hostSessions)
+    {
+        WorldHost host{config};
+        host.run(config.frames);
+        host.printReport();
+        return 0;
+    }
 
 #ifdef ecs_with_benchmarks
 
-    Benchmark bench = runWithBenchmarks();
+    Benchmark bench = runWithBenchmarks(config);
     bench.printBenchmarks();
 
 #else
 
-    Game game{};
-    game.run();
+    Game game{config};
+    if (config.frames)
+        game.run(config.frames).printBenchmarks();
+    else
+        game.run();
 
 #endif
     
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "core.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Per thread allocation counters, incremented by the global operator new overloads replaced in
+ * main.cpp. A thread only counts its own allocations, so the render thread's aren't charged to whichever
+ * system the simulation thread is running. Reads are only meaningful as differences, eg. allocations made
+ * during a frame or a system's update.
+ */
+namespace Allocations
+{
+inline thread_local uint64_t count{0};
+inline thread_local uint64_t bytes{0};
+
+inline void record(std::size_t size)
+{
+    ++count;
+    bytes += size;
+}
+
+struct Counts
+{
+    uint64_t count{};
+    uint64_t bytes{};
+
+    Counts operator-(const Counts &other) const
+    {
+        return Counts{count - other.count, bytes - other.bytes};
+    }
+
+    Counts &operator+=(const Counts &other)
+    {
+        count += other.count;
+        bytes += other.bytes;
+        return *this;
+    }
+};
+
+inline Counts get()
+{
+    return Counts{count, bytes};
+}
+
+/**
+ * @brief Get the process' resident memory, where the platform reports it, or 0
+ */
+inline uint64_t getResidentBytes()
+{
+#if defined(__linux__)
+    std::ifstream statm{"/proc/self/statm"};
+    uint64_t size{}, resident{};
+    if (statm >> size >> resident)
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+/**
+ * @brief Totals for one named scope, such as a system's update
+ */
+struct Tally
+{
+    const char *name;
+    Counts total{};
+    uint64_t calls{};
+    uint64_t allocatingCalls{};
+};
+
+/**
+ * @brief Allocations per frame and per system over a run. Systems are looked up by their name pointer, and
+ * room for them is reserved up front so recording doesn't allocate itself.
+ *
+ * Also checks that the frame loop stops allocating: once warmed up, every frame which still allocates is
+ * counted, and the first few are logged.
+ */
+class Report
+{
+  public:
+    // Frames after a reset or a warm up which may allocate, while buffers grow to fit the frame's work
+    static constexpr uint64_t WARMUP_FRAMES = 120;
+    // How many frames which allocate after warming up are logged
+    static constexpr uint64_t LOGGED_FRAMES = 8;
+
+    Report()
+    {
+        m_systems.reserve(32);
+    }
+
+    void reset()
+    {
+        m_systems.clear();
+        m_frames = Tally{"frames"};
+        m_steadyFrames = Tally{"steady frames"};
+        m_worstFrame = Counts{};
+        warmUp();
+    }
+
+    /**
+     * @brief Warm up again, for when the frame's work changes, eg. a stage is loaded
+     */
+    void warmUp()
+    {
+        m_warmupFrames = WARMUP_FRAMES;
+    }
+
+    void recordFrame(const Counts &counts)
+    {
+        add(m_frames, counts);
+        if (counts.count > m_worstFrame.count)
+            m_worstFrame = counts;
+        if (m_warmupFrames)
+        {
+            --m_warmupFrames;
+            return;
+        }
+
+        add(m_steadyFrames, counts);
+        if (counts.count && m_steadyFrames.allocatingCalls <= LOGGED_FRAMES)
+            PRINT("ZERO ALLOCATION CHECK: FRAME", m_frames.calls, "ALLOCATED", counts.count, "TIMES (",
+                  counts.bytes, "BYTES ) AFTER WARMING UP")
+    }
+
+    void recordSystem(const char *name, const Counts &counts)
+    {
+        auto tally = std::find_if(m_systems.begin(), m_systems.end(),
+                                  [&](const Tally &tally) { return tally.name == name; });
+        if (tally == m_systems.end())
+            tally = m_systems.insert(m_systems.end(), Tally{name});
+
+        add(*tally, counts);
+    }
+
+    void print() const
+    {
+        if (!m_frames.calls)
+            return;
+
+        PRINT("allocations:", m_frames.total.count, "(", m_frames.total.bytes, "bytes ) over", m_frames.calls,
+              "frames,", m_frames.allocatingCalls, "frames allocating, worst frame:", m_worstFrame.count, "(",
+              m_worstFrame.bytes, "bytes )")
+        for (const auto &tally : m_systems)
+            if (tally.total.count)
+                PRINT("  ", tally.name, "allocated", tally.total.count, "times (", tally.total.bytes,
+                      "bytes ) in", tally.allocatingCalls, "of", tally.calls, "updates")
+
+        if (!m_steadyFrames.calls)
+            PRINT("ZERO ALLOCATION CHECK NEEDS MORE THAN", WARMUP_FRAMES, "FRAMES")
+        else if (m_steadyFrames.allocatingCalls)
+            PRINT("ZERO ALLOCATION CHECK FAILED:", m_steadyFrames.allocatingCalls, "OF", m_steadyFrames.calls,
+                  "FRAMES AFTER WARMING UP ALLOCATED", m_steadyFrames.total.count, "TIMES")
+        else
+            PRINT("ZERO ALLOCATION CHECK PASSED OVER", m_steadyFrames.calls, "FRAMES AFTER WARMING UP")
+    }
+
+  private:
+    static void add(Tally &tally, const Counts &counts)
+    {
+        tally.total += counts;
+        ++tally.calls;
+        if (counts.count)
+            ++tally.allocatingCalls;
+    }
+
+    std::vector<Tally> m_systems{};
+    Tally m_frames{"frames"};
+    // Frames recorded after warming up
+    Tally m_steadyFrames{"steady frames"};
+    Counts m_worstFrame{};
+    uint64_t m_warmupFrames{WARMUP_FRAMES};
+};
+
+/**
+ * @brief Get the calling thread's report. Each thread records into its own, so the sessions a host runs at
+ * once don't share one
+ */
+inline Report &getReport()
+{
+    thread_local Report report{};
+    return report;
+}
+} // namespace Allocations
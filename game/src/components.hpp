@@ -3,6 +3,8 @@
 #include "core.hpp"
 #include "renderer.hpp"
 #include <cstdint>
+#include <memory>
+#include <span>
 
 using NoStack = ECS::Tags::NoStack;
 using Stack = ECS::Tags::Stack;
@@ -44,8 +46,16 @@ struct PlayerEvent : Event
     }
 };
 
-struct PlayerComponent : Unique
+struct PlayerComponent
 {
+    // The order the player joined in, which their inputs are registered by
+    uint32_t index;
+    EntityId scoreCardId{};
+    EntityId lifeCardId{};
+
+    PlayerComponent(uint32_t _index) : index(_index)
+    {
+    }
 };
 
 struct ScoreComponent
@@ -62,11 +72,15 @@ struct LivesComponent
     }
 };
 
-struct PlayerScoreCardComponent : Unique
+struct PlayerScoreCardComponent
+{
+};
+
+struct PlayerLifeCardComponent
 {
 };
 
-struct PlayerLifeCardComponent : Unique
+struct TelemetryCardComponent : Unique
 {
 };
 
@@ -83,17 +97,15 @@ struct AIComponent
 {
 };
 
-struct LeftAlienComponent : Stack
-{
-};
-
-struct RightAlienComponent : Stack
-{
-};
-
-struct HiveComponent : Unique
+struct HiveComponent
 {
     Bounds bounds{};
+    // The aliens at the hive's left and right edges, which are checked against the screen boundaries. Both
+    // are found again once either is gone
+    EntityId leftAlienId{};
+    EntityId rightAlienId{};
+    // How many aliens joined the hive. It speeds up as they are killed
+    uint32_t alienTotal{};
 };
 
 struct UFOAIComponent
@@ -109,6 +121,34 @@ struct HiveAIComponent
     }
 };
 
+/**
+ * @brief Every hive's aliens, gathered once per tick so the hive AI can run hive by hive without searching
+ * all aliens for each. Kept between ticks so it doesn't allocate once grown
+ */
+struct HiveRosterComponent : Unique
+{
+    struct Hive
+    {
+        EntityId id;
+        // The hive's range of alienIds
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    std::vector<Hive> hives{};
+    // Alien ids grouped by hive, in the order the hives are listed
+    std::vector<EntityId> alienIds{};
+    // Each hive's index in hives, indexed by hive id
+    std::vector<uint32_t> hiveIndices{};
+    // The hive created last, which aliens placed after it join
+    EntityId newestHiveId{};
+
+    std::span<const EntityId> getAliens(const Hive &hive) const
+    {
+        return {alienIds.data() + hive.begin, alienIds.data() + hive.end};
+    }
+};
+
 struct PlayerInputEvent : Event
 {
     Movements movement = Movements::NONE;
@@ -147,11 +187,11 @@ struct AIMovementEffect : Effect
 
 struct HiveMovementEffect : Effect, NoStack
 {
-    float moveInterval{0.5f};
+    SimTimer simTimer;
     Movements movement;
     Movements nextMove;
 
-    HiveMovementEffect(Movements _movement) : movement(_movement), Effect(0.5f)
+    HiveMovementEffect(Movements _movement, double _now) : simTimer(0.5f, _now), movement(_movement)
     {
     }
 };
@@ -262,6 +302,37 @@ struct DeathComponent
 {
 };
 
+/**
+ * @brief Contacts found by the collision system this frame, each pair listed once as (lower id, higher id),
+ * and the hits recorded from them for the fused combat pass in the order they occurred
+ */
+struct ContactBufferComponent : Unique
+{
+    struct Contact
+    {
+        EntityId firstId;
+        EntityId secondId;
+    };
+
+    struct Hit
+    {
+        EntityId targetId;
+        EntityId dealerId;
+    };
+
+    // A collidable entity the narrowphase tests against, with the bounds it is checking if it moved
+    struct Candidate
+    {
+        EntityId id;
+        const Bounds *bounds;
+        const Bounds *checkBounds;
+    };
+
+    std::vector<Contact> contacts{};
+    std::vector<Candidate> candidates{};
+    std::vector<Hit> hits{};
+};
+
 struct DeactivatedComponent
 {
 };
@@ -296,29 +367,37 @@ struct AttackEvent : Event
 struct AttackEffect : Effect, Stack
 {
     EntityId attackId;
+    SimTimer simTimer;
 
-    AttackEffect(EntityId _attackId, float _timeout = 0) : attackId(_attackId), Effect(_timeout)
+    AttackEffect(EntityId _attackId, float _timeout, double _now)
+        : attackId(_attackId), simTimer(_timeout, _now)
     {
     }
 };
 
 struct AITimeoutEffect : Effect, Stack
 {
-    AITimeoutEffect(float _duration) : Effect(_duration)
+    SimTimer simTimer;
+
+    AITimeoutEffect(float _duration, double _now) : simTimer(_duration, _now)
     {
     }
 };
 
 struct UFOTimeoutEffect : Effect, Stack
 {
-    UFOTimeoutEffect(float _duration) : Effect(_duration)
+    SimTimer simTimer;
+
+    UFOTimeoutEffect(float _duration, double _now) : simTimer(_duration, _now)
     {
     }
 };
 
 struct UFOAttackTimeoutEffect : Effect, Stack
 {
-    UFOAttackTimeoutEffect(float _duration) : Effect(_duration)
+    SimTimer simTimer;
+
+    UFOAttackTimeoutEffect(float _duration, double _now) : simTimer(_duration, _now)
     {
     }
 };
@@ -336,6 +415,7 @@ struct GameComponent : Required, Unique
     Bounds bounds;
     bool isGameOver{};
     int currentStage{1};
+    float difficultyModifier{1};
 
     GameComponent(Bounds _bounds) : bounds(_bounds)
     {
@@ -347,12 +427,153 @@ struct GameMetaComponent : Required, Unique
     Vector2 screen;
     int tileSize{};
     float deltaTime{};
+    // Accumulated simulation time in seconds, which all effect timers are measured against
+    double simTime{};
+    // Resolve collisions through the contact buffer in a single combat pass, instead of through events
+    bool fusedCombat{};
+    // State of the simulation's random number generator. See Random
+    uint64_t randomState{0x9E3779B97F4A7C15ull};
 
     GameMetaComponent(Vector2 _screen, int _tileSize) : screen(_screen), tileSize(_tileSize)
     {
     }
 };
 
+/**
+ * @brief Entity ids handed out and released, and the count of entities alive.  See Recycler
+ */
+struct EntityRecyclerComponent : Unique
+{
+    std::vector<EntityId> freeIds{};
+    // Removed this frame, and free from the next
+    std::vector<EntityId> releasedIds{};
+    // Highest id handed out, which a restored snapshot winds back
+    EntityId highestId{};
+    // Highest id the ECS library has handed out as far as the recycler knows, which only moves forward
+    EntityId reservedId{};
+    // Entities alive, counting the game entity the recycler is created on
+    uint32_t entityCount{1};
+    bool isReusing{};
+
+    EntityRecyclerComponent(EntityId _highestId = 0) : highestId(_highestId), reservedId(_highestId)
+    {
+    }
+};
+
+/**
+ * @brief Settings of the endless wave generator, only present in endless runs.  See Waves
+ */
+struct WaveComponent : Unique
+{
+    uint64_t seed;
+    // Share of the alien slots which are filled, from 0 to 1
+    float density;
+    // Most hives in a wave
+    int hives;
+
+    WaveComponent(uint64_t _seed, float _density, int _hives) : seed(_seed), density(_density), hives(_hives)
+    {
+    }
+};
+
+/**
+ * @brief Min-heap of timed effects ordered by the simulation time they expire at
+ */
+struct EffectExpiryComponent : Unique
+{
+    struct Expiry
+    {
+        double time;
+        EntityId id;
+        void (*expire)(ComponentManager &, EntityId, double);
+    };
+
+    std::vector<Expiry> queue{};
+};
+
+/**
+ * @brief Transformed component values memoized per entity.  A value is only reused within the frame it was
+ * computed in, and until the revision is bumped by a change to the transformation's inputs
+ */
+template <typename T> struct TransformCache
+{
+    struct Entry
+    {
+        uint64_t frame{};
+        uint64_t revision{};
+        T value{};
+    };
+
+    uint64_t frame{1};
+    uint64_t revision{};
+    std::vector<Entry> entries{};
+
+    const T *find(EntityId id) const
+    {
+        if (id >= entries.size())
+            return nullptr;
+
+        auto &entry = entries[id];
+        return entry.frame == frame && entry.revision == revision ? &entry.value : nullptr;
+    }
+
+    const T &store(EntityId id, T value)
+    {
+        if (id >= entries.size())
+            entries.resize(id + 1);
+
+        entries[id] = Entry{frame, revision, std::move(value)};
+        return entries[id].value;
+    }
+
+    /**
+     * @brief Release every entry. Dropped values are recomputed on their next use, so this is always safe
+     */
+    void compact()
+    {
+        entries.clear();
+        entries.shrink_to_fit();
+    }
+};
+
+/**
+ * @brief Shared with the registered transformations, so systems can advance and invalidate their caches
+ */
+struct TransformCacheComponent : Unique
+{
+    std::shared_ptr<TransformCache<MovementComponent>> movement;
+
+    TransformCacheComponent(std::shared_ptr<TransformCache<MovementComponent>> _movement)
+        : movement(std::move(_movement))
+    {
+    }
+};
+
+namespace Telemetry
+{
+class Series;
+}
+
+/**
+ * @brief Holds the telemetry series on the game entity while telemetry is enabled.  See Telemetry
+ */
+struct TelemetryComponent : Unique
+{
+    std::shared_ptr<Telemetry::Series> series;
+
+    TelemetryComponent(std::shared_ptr<Telemetry::Series> _series) : series(std::move(_series))
+    {
+    }
+};
+
+/**
+ * @brief Tag bits of each entity, indexed by entity id.  See TagMask
+ */
+struct TagMaskComponent : Unique
+{
+    std::vector<uint32_t> masks{};
+};
+
 enum class GameEvents
 {
     NONE = 0,
@@ -382,6 +603,12 @@ struct UIComponent
 {
 };
 
+struct RenderListComponent : Unique
+{
+    std::vector<EntityId> dirtyIds{};
+    bool isStale{true};
+};
+
 enum class UIEvents
 {
     NONE = 0,
@@ -446,14 +673,18 @@ struct PowerupComponent
 
 struct PowerupEffect : Effect
 {
-    PowerupEffect() : Effect(10)
+    SimTimer simTimer;
+
+    PowerupEffect(double _now) : simTimer(10, _now)
     {
     }
 };
 
 struct PowerupTimeoutEffect : Effect
 {
-    PowerupTimeoutEffect() : Effect(30)
+    SimTimer simTimer;
+
+    PowerupTimeoutEffect(double _now) : simTimer(30, _now)
     {
     }
 };
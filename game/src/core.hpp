@@ -10,6 +10,7 @@
 #include <limits>
 #include <memory>
 #include <stack>
+#include <string>
 #include <typeindex>
 #include <unordered_map>
 #include <utility>
@@ -21,7 +22,15 @@ using EntityId = uint32_t;
 using EId = EntityId;
 using ComponentManager = ECS::Manager<EntityId>;
 
-#define PRINT(...) ECS::internal::Utilities::print(__VA_ARGS__);
+// Silences PRINT on the calling thread, for threads running many games at once
+inline thread_local bool isPrintMuted{false};
+
+#define PRINT(...)                                                                                           \
+    do                                                                                                       \
+    {                                                                                                        \
+        if (!isPrintMuted)                                                                                   \
+            ECS::internal::Utilities::print(__VA_ARGS__);                                                    \
+    } while (0);
 
 /**
  * @brief Generic inputs to be converted into game inputs
@@ -34,15 +43,113 @@ enum class Inputs
     RIGHT,
     SHOOT,
     MENU,
+    TRACE,
+    OVERLAY,
+    SAVE,
+    LOAD,
     QUIT,
 };
 
+enum class PacingMode
+{
+    UNCAPPED,
+    FIXED,
+    // Presenting blocks on the display refresh, so there is nothing to wait for
+    VSYNC,
+};
+
+// Rate fixed pacing runs at when none is given, that of a typical display
+constexpr int DEFAULT_FIXED_FPS = 60;
+
+/**
+ * @brief How a world host's sessions are divided between its workers
+ */
+enum class HostSchedule
+{
+    // Every worker runs a fixed slice of the sessions: worker w runs sessions w, w + workers, ...
+    ROUND_ROBIN,
+    // Every worker starts on its own block of sessions, and takes sessions from the other workers' blocks
+    // once it runs out, so workers which drew cheap sessions help with the expensive ones
+    WORK_STEALING,
+};
+
+/**
+ * @brief Options for how the game loop is run
+ */
+struct RunConfig
+{
+    // Render on a dedicated thread from published snapshots, instead of between simulation updates
+    bool renderThread{false};
+    // Render into a CPU framebuffer without initializing SDL
+    bool headless{false};
+    // Directory to dump headless frames to, and how many frames apart to dump them
+    std::string captureDir{};
+    int captureInterval{1};
+    bool capturePPM{false};
+    // Generate scripted player inputs, for runs without a player
+    bool autopilot{false};
+    // How frames are paced, and the target rate for fixed pacing. 0 uses DEFAULT_FIXED_FPS
+    PacingMode pacing{PacingMode::UNCAPPED};
+    int fps{0};
+    // Advance the simulation clock by this many seconds every frame, instead of by the measured frame time.
+    // Combined with uncapped pacing this fast-forwards the game with the same behaviour as real time
+    float simStep{0};
+    // Resolve damage, health, deaths and score from collisions in a single pass
+    bool fusedCombat{false};
+    // Record a timeline of frame phases and systems, written as Chrome trace JSON on exit and on F9
+    std::string traceFile{};
+    // Sample entity, component and event counts every tick, written as CSV on exit, and optionally shown
+    std::string telemetryFile{};
+    bool telemetryCard{false};
+    // Start with the performance overlay shown. It is toggled with F3 either way
+    bool overlay{false};
+    // Snapshot file saved to with F5 and loaded from with F8. It can also be loaded at startup, to benchmark
+    // from a checkpoint, or saved on a given frame, to make one without playing
+    std::string snapshotFile{"snapshot.bin"};
+    bool loadSnapshot{false};
+    int saveSnapshotAt{0};
+    // Record every tick into the rollback history, and rewind and resimulate this many ticks every frame, to
+    // benchmark rollback
+    int rollbackDepth{0};
+    // Hash the simulation state every tick, optionally writing the hashes to a log or comparing them against
+    // one, to find where runs of the same replay diverge
+    bool hashState{false};
+    std::string hashLog{};
+    std::string hashReference{};
+    // Skip the title page and start at this stage, such as one of the stress stages from 100 on
+    int startStage{0};
+    // Players in the game. Players after the first stand in for remote players, and are played by the
+    // autopilot
+    int players{1};
+    // Generate every stage after the fixed ones, from the seed, with this share of the alien slots filled and
+    // up to this many hives, and check that memory stays flat from wave to wave
+    bool endless{false};
+    uint64_t waveSeed{1};
+    float waveDensity{0.5f};
+    int waveHives{3};
+    // Run the game on an authoritative server thread, with this process as a client which only sends inputs
+    // and renders the server's updates. The server ticks at the tick rate, or uncapped at 0
+    bool loopback{false};
+    int tickRate{60};
+    // Run this many independent headless sessions in one process instead of the game, on this many worker
+    // threads, or one per core at 0. Every session ticks at a fixed step of the sim step, or 1 / tick rate
+    int hostSessions{0};
+    int hostThreads{0};
+    HostSchedule hostSchedule{HostSchedule::WORK_STEALING};
+    // Run one of the benchmark scenarios by name, or all of them, instead of the game. Each runs at growing
+    // entity counts up to its full count times the scale, or its default count at 0, for the frame count of
+    // ticks or 60 at each
+    std::string scenario{};
+    float scenarioScale{0};
+    // Stop after this many frames and report the benchmark. 0 runs until quit
+    int frames{0};
+};
+
 struct ScreenConfig
 {
     const int width{640};
     const int height{480};
     const int fps{30000};
-    const int ticks_per_frame{1000 / fps};
 };
 
 /**
@@ -91,6 +198,46 @@ class Bounds
     }
 };
 
+/**
+ * @brief Timer measured against the accumulated simulation clock rather than the wall clock, so effects
+ * expire after the same number of simulated seconds no matter how fast the simulation runs
+ */
+class SimTimer
+{
+  public:
+    SimTimer(float duration, double start) : m_duration(duration), m_start(start)
+    {
+    }
+
+    bool hasElapsed(double now) const
+    {
+        return now >= getExpiry();
+    }
+
+    double getExpiry() const
+    {
+        return m_start + m_duration;
+    }
+
+    /**
+     * @brief Restart the timer with a new duration
+     */
+    void update(float duration, double now)
+    {
+        m_duration = duration;
+        m_start = now;
+    }
+
+    float getRemaining(double now) const
+    {
+        return getExpiry() - now;
+    }
+
+  private:
+    float m_duration;
+    double m_start;
+};
+
 /**
  * @brief Provides simple benchmarking utilities
  */
@@ -2,87 +2,183 @@
 
 #include "components.hpp"
 #include "core.hpp"
+#include "random.hpp"
+#include "recycler.hpp"
+#include "render_list.hpp"
+#include "tags.hpp"
+#include "timers.hpp"
 #include "renderer.hpp"
+#include <array>
+#include <string>
+#include <string_view>
 
 /******************************************/
 // Template-compatible Entity Constructors
 /******************************************/
 
+using EntityConstructor = EntityId (*)(ComponentManager &cm, float x, float y, float w, float h);
+
 inline EntityId hive(ComponentManager &cm, float x, float y, float w, float h)
 {
-    EntityId hiveId = cm.createEntity();
+    EntityId hiveId = Recycler::create(cm);
     PRINT("CREATE HIVE", hiveId)
-    cm.clear<HiveComponent, HiveMovementEffect>();
     auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
     auto &size = gameMetaComps.peek(&GameMetaComponent::screen);
+    auto &now = gameMetaComps.peek(&GameMetaComponent::simTime);
     cm.add<HiveComponent>(hiveId);
-    cm.add<HiveMovementEffect>(hiveId, Movements::RIGHT);
+    auto [rosterId, rosterComps] = cm.getUnique<HiveRosterComponent>();
+    rosterComps.mutate([&](HiveRosterComponent &roster) { roster.newestHiveId = hiveId; });
+    cm.add<HiveMovementEffect>(hiveId, Movements::RIGHT, now);
     cm.add<MovementComponent>(hiveId, Vector2{size.x / 200, size.y / 50});
-    cm.add<AttackEffect>(hiveId, 0, 3);
+    Timers::add<AttackEffect>(cm, hiveId, 0, 3, now);
 
     return hiveId;
 }
 
 inline EntityId player(ComponentManager &cm, float x, float y, float w, float h)
 {
-    EntityId id = cm.createEntity();
+    EntityId id = Recycler::create(cm);
+    auto index = static_cast<uint32_t>(cm.getEntityIds<PlayerComponent>().size());
 
     PRINT("CREATE PLAYER", id)
-    cm.add<CollidableComponent>(id);
-    cm.add<PlayerComponent>(id);
+    // Players after the first are told apart by colour
+    static const std::array<Renderer::RGBA, 4> colors{
+        Renderer::RGBA{0, 255, 0, 255}, Renderer::RGBA{0, 200, 255, 255}, Renderer::RGBA{255, 200, 0, 255},
+        Renderer::RGBA{255, 0, 255, 255}};
+    TagMask::add<CollidableComponent>(cm, id);
+    TagMask::add<PlayerComponent>(cm, id, index);
     cm.add<PositionComponent>(id, Bounds{x - (w / 4), y + (h / 2), w * 1.5f, h - (h / 2)});
-    cm.add<SpriteComponent>(id, Renderer::RGBA{0, 255, 0, 255});
+    cm.add<SpriteComponent>(id, colors[index % colors.size()]);
     cm.add<MovementComponent>(id, Vector2{w * 10, w * 10});
     cm.add<AttackComponent>(id, Movements::UP);
     cm.add<HealthComponent>(id, 10);
     cm.add<DamageComponent>(id, 25.0f);
     cm.add<ScoreComponent>(id, 0);
     cm.add<LivesComponent>(id, 3);
+    RenderList::markDirty(cm, id);
 
     return id;
 };
 
+/**
+ * @brief Text of a player's score or lives card. Cards of players after the first are labelled with their
+ * player
+ */
+inline std::string getPlayerCardText(uint32_t index, std::string_view label, int value)
+{
+    auto text = index ? "P" + std::to_string(index + 1) + " " : std::string{};
+    return text.append(label).append(": ").append(std::to_string(value));
+}
+
+/**
+ * @brief Give a card to the first player without one, returning the player's index
+ */
+template <auto Card> inline uint32_t assignPlayerCard(ComponentManager &cm, EntityId cardId)
+{
+    for (const auto &playerId : cm.getEntityIds<PlayerComponent>())
+    {
+        auto [playerComps] = cm.get<PlayerComponent>(playerId);
+        if (playerComps.peek(Card))
+            continue;
+
+        playerComps.mutate([&](PlayerComponent &playerComp) { playerComp.*Card = cardId; });
+        return playerComps.peek(&PlayerComponent::index);
+    }
+
+    return 0;
+}
+
 inline EntityId playerScore(ComponentManager &cm, float x, float y, float w, float h)
 {
-    EntityId id = cm.createEntity();
+    EntityId id = Recycler::create(cm);
 
     PRINT("CREATE PLAYER SCORE", id)
+    auto index = assignPlayerCard<&PlayerComponent::scoreCardId>(cm, id);
     cm.add<PositionComponent>(id, Bounds{x, y, w, h});
     cm.add<SpriteComponent>(id, Renderer::RGBA{0, 0, 0, 0});
-    cm.add<UIComponent>(id);
-    cm.add<TextComponent>(id, "SCORE: 0");
+    TagMask::add<UIComponent>(cm, id);
+    cm.add<TextComponent>(id, getPlayerCardText(index, "SCORE", 0));
     cm.add<PlayerScoreCardComponent>(id);
+    RenderList::markDirty(cm, id);
 
     return id;
 };
 
 inline EntityId playerLives(ComponentManager &cm, float x, float y, float w, float h)
 {
-    EntityId id = cm.createEntity();
+    EntityId id = Recycler::create(cm);
 
     PRINT("CREATE PLAYER LIVES", id)
+    auto index = assignPlayerCard<&PlayerComponent::lifeCardId>(cm, id);
     cm.add<PositionComponent>(id, Bounds{x, y, w, h});
     cm.add<SpriteComponent>(id, Renderer::RGBA{0, 0, 0, 0});
-    cm.add<UIComponent>(id);
-    cm.add<TextComponent>(id, "LIVES: 3");
+    TagMask::add<UIComponent>(cm, id);
+    cm.add<TextComponent>(id, getPlayerCardText(index, "LIVES", 3));
     cm.add<PlayerLifeCardComponent>(id);
+    RenderList::markDirty(cm, id);
+
+    return id;
+};
+
+inline EntityId telemetryCard(ComponentManager &cm, float x, float y, float w, float h)
+{
+    EntityId id = Recycler::create(cm);
+
+    PRINT("CREATE TELEMETRY CARD", id)
+    cm.add<PositionComponent>(id, Bounds{x, y, w, h});
+    cm.add<SpriteComponent>(id, Renderer::RGBA{0, 0, 0, 0});
+    TagMask::add<UIComponent>(cm, id);
+    cm.add<TextComponent>(id, "");
+    cm.add<TelemetryCardComponent>(id);
+    RenderList::markDirty(cm, id);
+
+    return id;
+};
+
+inline EntityId overlayLine(ComponentManager &cm, float x, float y, float w, float h)
+{
+    EntityId id = Recycler::create(cm);
+
+    cm.add<PositionComponent>(id, Bounds{x, y, w, h});
+    cm.add<SpriteComponent>(id, Renderer::RGBA{0, 0, 0, 0});
+    TagMask::add<UIComponent>(cm, id);
+    cm.add<TextComponent>(id, "");
+    RenderList::markDirty(cm, id);
+
+    return id;
+};
+
+inline EntityId overlayBar(ComponentManager &cm, float x, float y, float w, float h)
+{
+    EntityId id = Recycler::create(cm);
+
+    cm.add<PositionComponent>(id, Bounds{x, y, w, h});
+    cm.add<SpriteComponent>(id, Renderer::RGBA{0, 255, 0, 200});
+    TagMask::add<UIComponent>(cm, id);
+    RenderList::markDirty(cm, id);
 
     return id;
 };
 
 inline EntityId hiveAlien(ComponentManager &cm, float x, float y, float w, float h)
 {
-    EntityId id = cm.createEntity();
-    auto [hiveId, _] = cm.getUnique<HiveComponent>();
+    EntityId id = Recycler::create(cm);
+    // Aliens join the hive placed last before them in the template
+    auto [_, rosterComps] = cm.getUnique<HiveRosterComponent>();
+    EntityId hiveId = rosterComps.peek(&HiveRosterComponent::newestHiveId);
+    auto [hiveComps] = cm.get<HiveComponent>(hiveId);
+    if (hiveComps)
+        hiveComps.mutate([](HiveComponent &hiveComp) { ++hiveComp.alienTotal; });
     float diff = 7;
-    cm.add<CollidableComponent>(id);
+    TagMask::add<CollidableComponent>(cm, id);
     cm.add<AIComponent>(id);
-    cm.add<HiveAIComponent>(id, hiveId);
+    TagMask::add<HiveAIComponent>(cm, id, hiveId);
     cm.add<PositionComponent>(id, Bounds{x - diff, y, w + diff, h});
     cm.add<MovementComponent>(id, Vector2{w / 2, w});
     cm.add<AttackComponent>(id, Movements::DOWN);
     cm.add<HealthComponent>(id, 10);
     cm.add<DamageComponent>(id, 25.0f);
+    RenderList::markDirty(cm, id);
 
     return id;
 };
@@ -116,10 +212,11 @@ inline EntityId hiveAlienLarge(ComponentManager &cm, float x, float y, float w,
 
 inline EntityId collidableObstacleBlock(ComponentManager &cm, float x, float y, float w, float h)
 {
-    EntityId id = cm.createEntity();
-    cm.add<ObstacleComponent>(id);
-    cm.add<CollidableComponent>(id);
+    EntityId id = Recycler::create(cm);
+    TagMask::add<ObstacleComponent>(cm, id);
+    TagMask::add<CollidableComponent>(cm, id);
     cm.add<DamageComponent>(id, 1);
+    RenderList::markDirty(cm, id);
 
     return id;
 }
@@ -190,22 +287,29 @@ inline void createGame(ComponentManager &cm, Vector2 &size, int tileSize)
     PRINT("CREATE GAME", gameId)
     cm.add<GameMetaComponent>(gameId, size, tileSize);
     cm.add<GameComponent>(gameId, Bounds{0, 0, size.x, size.y});
-    cm.add<UFOTimeoutEffect>(gameId, 12);
-    cm.add<PowerupTimeoutEffect>(gameId);
+    cm.add<RenderListComponent>(gameId);
+    cm.add<EffectExpiryComponent>(gameId);
+    cm.add<ContactBufferComponent>(gameId);
+    cm.add<HiveRosterComponent>(gameId);
+    cm.add<TagMaskComponent>(gameId);
+    cm.add<EntityRecyclerComponent>(gameId, gameId);
+    // The simulation clock starts at zero along with the game
+    Timers::add<UFOTimeoutEffect>(cm, gameId, 12, 0);
+    Timers::add<PowerupTimeoutEffect>(cm, gameId, 0);
 }
 
 inline EntityId createUfo(ComponentManager &cm, float x, float y)
 {
-    EntityId id = cm.createEntity();
+    EntityId id = Recycler::create(cm);
     PRINT("UFO SPAWNED", id)
-    cm.add<UFOAIComponent>(id);
+    TagMask::add<UFOAIComponent>(cm, id);
     auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
     auto &size = gameMetaComps.peek(&GameMetaComponent::screen);
     const float &tileSize = gameMetaComps.peek(&GameMetaComponent::tileSize);
     float diff = 15;
     float newW = tileSize + diff;
     float newX = x - newW;
-    cm.add<CollidableComponent>(id);
+    TagMask::add<CollidableComponent>(cm, id);
     cm.add<PositionComponent>(id, Bounds{newX, y, newW, tileSize});
     cm.add<AttackComponent>(id, Movements::DOWN);
     cm.add<HealthComponent>(id, 10);
@@ -214,20 +318,22 @@ inline EntityId createUfo(ComponentManager &cm, float x, float y)
     cm.add<MovementComponent>(id, Vector2{tileSize * 4, tileSize * 4});
     cm.add<MovementEffect>(id, Vector2{tileSize * size.x, tileSize / 2});
     cm.add<SpriteComponent>(id, Renderer::RGBA{255, 0, 0, 255});
-    float randomDelay = std::rand() % 5;
-    cm.add<AttackEffect>(id, randomDelay);
+    float randomDelay = Random::next(cm) % 5;
+    Timers::add<AttackEffect>(cm, id, randomDelay, 0, gameMetaComps.peek(&GameMetaComponent::simTime));
+    RenderList::markDirty(cm, id);
 
     return id;
 };
 
 inline EntityId createProjectile(ComponentManager &cm, Bounds bounds)
 {
-    EntityId id = cm.createEntity();
+    EntityId id = Recycler::create(cm);
     auto [w, h] = bounds.size;
-    cm.add<CollidableComponent>(id);
+    TagMask::add<CollidableComponent>(cm, id);
     cm.add<MovementComponent>(id, Vector2{0, w * 10});
     cm.add<SpriteComponent>(id, Renderer::RGBA{255, 255, 255, 255});
     cm.add<HealthComponent>(id, 1);
+    RenderList::markDirty(cm, id);
     return id;
 };
 
@@ -242,7 +348,7 @@ inline EntityId createUpwardProjectile(ComponentManager &cm, EntityId shooterId,
     cm.add<MovementEffect>(id, Vector2{newX, -10000});
     cm.add<PositionComponent>(id, Bounds{newX, newY, newW, newH});
     using Movements = decltype(ProjectileComponent::movement);
-    cm.add<ProjectileComponent>(id, shooterId, Movements::UP);
+    TagMask::add<ProjectileComponent>(cm, id, shooterId, Movements::UP);
 
     return id;
 }
@@ -258,7 +364,7 @@ inline EntityId createDownwardProjectile(ComponentManager &cm, EntityId shooterI
     cm.add<MovementEffect>(id, Vector2{newX, 10000});
     cm.add<PositionComponent>(id, Bounds{newX, newY + 1, newW, newH});
     using Movements = decltype(ProjectileComponent::movement);
-    cm.add<ProjectileComponent>(id, shooterId, Movements::DOWN);
+    TagMask::add<ProjectileComponent>(cm, id, shooterId, Movements::DOWN);
     cm.add<PointsComponent>(id, 10);
 
     return id;
@@ -266,13 +372,14 @@ inline EntityId createDownwardProjectile(ComponentManager &cm, EntityId shooterI
 
 inline EntityId createPowerup(ComponentManager &cm, Bounds bounds)
 {
-    EntityId id = cm.createEntity();
+    EntityId id = Recycler::create(cm);
     PRINT("POWERUP SPAWNED", id)
-    cm.add<CollidableComponent>(id);
+    TagMask::add<CollidableComponent>(cm, id);
     cm.add<HealthComponent>(id, 1);
     cm.add<SpriteComponent>(id, Renderer::RGBA{255, 255, 0, 255});
     cm.add<PositionComponent>(id, bounds);
-    cm.add<PowerupComponent>(id);
+    TagMask::add<PowerupComponent>(cm, id);
+    RenderList::markDirty(cm, id);
 
     return id;
 }
@@ -1,9 +1,26 @@
 #pragma once
 
+#include "allocations.hpp"
 #include "core.hpp"
+#include "overlay.hpp"
+#include "pacer.hpp"
+#include "render_list.hpp"
+#include "render_thread.hpp"
 #include "renderer.hpp"
+#include "rollback.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
+#include "software_renderer.hpp"
+#include "state_hash.hpp"
+#include "telemetry.hpp"
+#include "trace.hpp"
 #include "update.hpp"
 #include "utilities.hpp"
+#include "waves.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
 #include <stdexcept>
 
 /**
@@ -12,13 +29,28 @@
 class Game
 {
   public:
+    Game(RunConfig config = {}) : m_config(config)
+    {
+        // Headless and render thread frames never wait on a present, so vsync would leave them uncapped
+        auto pacing = config.pacing;
+        if (pacing == PacingMode::VSYNC && (config.headless || config.renderThread))
+        {
+            PRINT("VSYNC PACING IS NOT AVAILABLE HEADLESS OR ON THE RENDER THREAD, PACING FIXED INSTEAD")
+            pacing = PacingMode::FIXED;
+        }
+        m_pacer.setMode(pacing);
+        m_pacer.setRate(config.fps ? config.fps : DEFAULT_FIXED_FPS);
+        m_renderManager.setVsync(pacing == PacingMode::VSYNC);
+        Trace::setEnabled(!config.traceFile.empty());
+    }
+
     Benchmark run(int cycles)
     {
         if (!init())
             throw std::runtime_error("Game initialization failed");
 
         Benchmark benchmark;
-        benchmark.run([&]() -> int { return loop(cycles); });
+        benchmark.run([&]() -> int { return m_config.loopback ? loopClient(cycles) : loop(cycles); });
 
         return benchmark;
     }
@@ -28,21 +60,64 @@ class Game
         if (!init())
             throw std::runtime_error("Game initialization failed");
 
-        loop();
+        if (m_config.loopback)
+            loopClient();
+        else
+            loop();
     }
 
   private:
     bool init()
     {
+        // SDL is initialized on the render thread itself when rendering is threaded, and not at all when
+        // rendering headless
+        if (m_config.renderThread || m_config.headless)
+        {
+            initializeGame();
+            return true;
+        }
+
         if (!m_renderManager.init())
             throw std::runtime_error("Renderer initialization failed!");
 
-        Utilities::initializeGame(m_entityComponentManager, m_screenConfig);
+        initializeGame();
         m_renderManager.startRender();
 
         return true;
     }
 
+    void initializeGame()
+    {
+        // In loopback runs the world lives on the server
+        if (m_config.loopback)
+        {
+            m_server = std::make_unique<Server>(m_config);
+            return;
+        }
+
+        Utilities::initializeGame(m_entityComponentManager, m_screenConfig);
+        Utilities::setFusedCombat(m_entityComponentManager, m_config.fusedCombat);
+        Overlay::enable(m_entityComponentManager, m_config.overlay);
+        if (m_config.endless)
+            Waves::enable(m_entityComponentManager, m_config);
+        if (m_config.startStage)
+            Utilities::startAtStage(m_entityComponentManager, m_config.startStage);
+        Utilities::joinPlayers(m_entityComponentManager, m_config.players);
+        if (m_config.loadSnapshot)
+            loadSnapshot();
+        if (!m_config.telemetryFile.empty() || m_config.telemetryCard)
+            Telemetry::enable(m_entityComponentManager, m_config.telemetryCard);
+        if (!m_config.hashLog.empty() && !m_stateHash.openLog(m_config.hashLog))
+            PRINT("FAILED TO OPEN STATE HASH LOG", m_config.hashLog)
+        if (!m_config.hashReference.empty() && !m_stateHash.openReference(m_config.hashReference))
+            PRINT("FAILED TO READ STATE HASH REFERENCE", m_config.hashReference)
+    }
+
+    bool isHashingState() const
+    {
+        return m_config.hashState || !m_config.hashLog.empty() || !m_config.hashReference.empty();
+    }
+
     /**
      * @brief Main game update loops where player input, system updates, and rerendering happens
      *
@@ -54,16 +129,35 @@ class Game
 
         int cycleCount{0};
         bool quit{false};
-        float prevTime{0.0f};
+        // Reused every frame, so polling doesn't allocate once it has grown to fit
+        Utilities::PlayerInputs inputs(m_config.players);
+        for (auto &playerInputs : inputs)
+            playerInputs.reserve(static_cast<int>(Inputs::QUIT) + 1);
+        Allocations::getReport().reset();
+        m_lastAllocations = Allocations::get();
+        int stage{};
+
+        Trace::nameThread("simulation");
+        if (m_config.renderThread)
+            m_renderThread.start();
 
         while (!quit)
         {
             if (cycleCount++ > limit && limit)
                 break;
 
-            float startTime = m_renderManager.tick();
+            TRACE_SCOPE("Game::frame");
+            m_pacer.beginFrame();
+            auto allocations = Allocations::get();
+            auto frameAllocations = allocations - m_lastAllocations;
+            m_lastAllocations = allocations;
+            if (cycleCount > 1)
+                Allocations::getReport().recordFrame(frameAllocations);
 
-            auto inputs = m_renderManager.pollInputs();
+            pollInputs(inputs[0], cycleCount);
+            Utilities::addBotInputs(inputs, cycleCount);
+            if (m_config.rollbackDepth)
+                rollback(inputs);
             Utilities::registerPlayerInputs(m_entityComponentManager, inputs);
 
             if (!Update::run(m_entityComponentManager))
@@ -73,35 +167,258 @@ class Game
                 continue;
             };
 
-            updateRenderer();
-            waitIfNecessary(startTime);
+            // Loading a stage grows buffers to fit it, so the allocation check warms up again
+            auto [gameId, gameComps] = m_entityComponentManager.getUnique<GameComponent>();
+            if (gameComps.peek(&GameComponent::currentStage) != stage)
+            {
+                stage = gameComps.peek(&GameComponent::currentStage);
+                Allocations::getReport().warmUp();
+            }
 
-            float delta = (startTime - prevTime) / 1000.0f;
-            setDeltaTime(delta);
+            if (isHashingState())
+                m_stateHash.record(m_entityComponentManager, cycleCount);
+            if (m_config.endless)
+                m_waveCheck.sample(m_entityComponentManager, cycleCount);
+            Overlay::recordFrame(m_entityComponentManager, m_pacer.getDeltaTime(), frameAllocations);
+            present(cycleCount);
+            {
+                TRACE_SCOPE("Game::wait");
+                m_pacer.wait();
+            }
 
-            prevTime = startTime;
+            setDeltaTime(m_config.simStep ? m_config.simStep : m_pacer.getDeltaTime());
         }
 
         PRINT("\n $$$$$ GAME OVER $$$$$ \n\n")
+        m_pacer.printReport();
+        m_rollbackReport.print(m_history, getRollbackDepth());
+        m_stateHash.printReport();
+        m_waveCheck.printReport();
+        Allocations::getReport().print();
+        exportTrace();
+        exportTelemetry();
+        stopRendering();
+
+        return cycleCount;
+    }
+
+    /**
+     * @brief Client loop for loopback runs. The world is simulated by the server, so a frame only sends the
+     * inputs, applies the updates the server has sent since the last frame, and renders
+     *
+     * @param limit - Optional frame limit.  Game terminates when the limit is reached.
+     */
+    int loopClient(int limit = 0)
+    {
+        PRINT("\n $$$$$ STARTING GAME $$$$$ \n")
+
+        int cycleCount{0};
+        Utilities::PlayerInputs inputs(m_config.players);
+        for (auto &playerInputs : inputs)
+            playerInputs.reserve(static_cast<int>(Inputs::QUIT) + 1);
+        std::vector<uint8_t> message{};
+        uint64_t serverTick{};
+
+        Trace::nameThread("client");
+        if (m_config.renderThread)
+            m_renderThread.start();
+        m_server->start();
 
-        m_renderManager.exit();
+        while (!m_server->isFinished())
+        {
+            if (cycleCount++ > limit && limit)
+                break;
+
+            TRACE_SCOPE("Client::frame");
+            m_pacer.beginFrame();
+            readInputs(inputs[0], cycleCount);
+            if (std::find(inputs[0].begin(), inputs[0].end(), Inputs::TRACE) != inputs[0].end())
+                exportTrace();
+            Utilities::addBotInputs(inputs, cycleCount);
+            for (std::size_t player = 0; player < inputs.size(); ++player)
+            {
+                Net::encodeInputs(inputs[player], message);
+                m_server->getInputs(player).send(message);
+            }
+
+            while (m_server->getUpdates().receive(message))
+                if (!Net::applyUpdate(message, m_renderElements, serverTick))
+                    PRINT("MALFORMED UPDATE FROM SERVER AT TICK", serverTick)
+
+            {
+                TRACE_SCOPE("Game::render");
+                draw(cycleCount);
+            }
+            {
+                TRACE_SCOPE("Game::wait");
+                m_pacer.wait();
+            }
+        }
+
+        m_server->stop();
+        PRINT("\n $$$$$ GAME OVER $$$$$ \n\n")
+        m_pacer.printReport();
+        m_server->printReport();
+        exportTrace();
+        stopRendering();
 
         return cycleCount;
     }
 
+    void stopRendering()
+    {
+        if (m_config.renderThread)
+            m_renderThread.stop();
+        else if (!m_config.headless)
+            m_renderManager.exit();
+    }
+
+    /**
+     * @brief Read this frame's inputs from the renderer, and from the autopilot if enabled
+     */
+    void readInputs(std::vector<Inputs> &inputs, int cycle)
+    {
+        TRACE_SCOPE("Game::poll");
+        if (m_config.renderThread)
+            m_renderThread.consumeInputs(inputs);
+        else if (m_config.headless)
+            inputs.clear();
+        else
+            m_renderManager.pollInputs(inputs);
+
+        if (m_config.autopilot)
+            Utilities::addAutopilotInputs(inputs, cycle);
+    }
+
+    void pollInputs(std::vector<Inputs> &inputs, int cycle)
+    {
+        readInputs(inputs, cycle);
+        if (std::find(inputs.begin(), inputs.end(), Inputs::TRACE) != inputs.end())
+            exportTrace();
+        if (std::find(inputs.begin(), inputs.end(), Inputs::OVERLAY) != inputs.end())
+            Overlay::toggle(m_entityComponentManager);
+        if (std::find(inputs.begin(), inputs.end(), Inputs::SAVE) != inputs.end() ||
+            cycle == m_config.saveSnapshotAt)
+            saveSnapshot();
+        if (std::find(inputs.begin(), inputs.end(), Inputs::LOAD) != inputs.end())
+            loadSnapshot();
+    }
+
+    void present(int cycle)
+    {
+        TRACE_SCOPE("Game::render");
+        RenderList::sync(m_entityComponentManager, m_renderElements);
+        draw(cycle);
+    }
+
+    /**
+     * @brief Draw the retained render elements
+     */
+    void draw(int cycle)
+    {
+        if (m_config.renderThread)
+            m_renderThread.publish(m_renderElements, cycle);
+        else if (m_config.headless)
+            renderHeadless(cycle);
+        else
+            updateRenderer();
+    }
+
     void updateRenderer()
     {
         m_renderManager.clear();
-        auto renders = Utilities::getRenderableElements(m_entityComponentManager);
-        m_renderManager.render(renders);
+        m_renderManager.render(m_renderElements.world(), m_renderElements.ui());
+    }
+
+    void renderHeadless(int cycle)
+    {
+        m_rasterizer.clear();
+        m_rasterizer.render(m_renderElements.world(), m_renderElements.ui());
+
+        if (m_config.captureDir.empty() || cycle % m_config.captureInterval)
+            return;
+
+        std::filesystem::create_directories(m_config.captureDir);
+        std::string fileName = std::to_string(cycle);
+        fileName.insert(0, 6 - std::min<std::size_t>(fileName.size(), 6), '0');
+        auto path = std::filesystem::path{m_config.captureDir} / ("frame_" + fileName);
+
+        bool isWritten = m_config.capturePPM ? m_rasterizer.writePPM(path.string() + ".ppm")
+                                             : m_rasterizer.writePNG(path.string() + ".png");
+        if (!isWritten)
+            PRINT("FAILED TO WRITE FRAME", path.string())
+    }
+
+    void exportTrace()
+    {
+        if (m_config.traceFile.empty())
+            return;
+
+        if (Trace::exportJson(m_config.traceFile))
+            PRINT("TRACE WRITTEN TO", m_config.traceFile)
+        else
+            PRINT("FAILED TO WRITE TRACE", m_config.traceFile)
+    }
+
+    void saveSnapshot()
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool isSaved = Snapshot::save(m_entityComponentManager, m_config.snapshotFile);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        if (isSaved)
+            PRINT("SNAPSHOT SAVED TO", m_config.snapshotFile, "IN", elapsed.count(), "us")
+        else
+            PRINT("FAILED TO SAVE SNAPSHOT", m_config.snapshotFile)
+    }
+
+    void loadSnapshot()
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool isLoaded = Snapshot::load(m_entityComponentManager, m_config.snapshotFile);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        if (isLoaded)
+            PRINT("SNAPSHOT LOADED FROM", m_config.snapshotFile, "IN", elapsed.count(), "us")
+        else
+            PRINT("FAILED TO LOAD SNAPSHOT", m_config.snapshotFile)
+    }
+
+    int getRollbackDepth() const
+    {
+        return std::min<int>(m_config.rollbackDepth, Rollback::HISTORY_TICKS - 1);
+    }
+
+    /**
+     * @brief Record the coming tick, then rewind and resimulate the configured number of ticks with the same
+     * inputs, as a rollback would after a late input
+     */
+    void rollback(const Utilities::PlayerInputs &inputs)
+    {
+        TRACE_SCOPE("Game::rollback");
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+        m_history.record(m_entityComponentManager, inputs);
+        auto recorded = Clock::now();
+        m_rollbackReport.recordCapture(recorded - start);
+
+        auto depth = getRollbackDepth();
+        if (m_history.getSize() <= static_cast<std::size_t>(depth))
+            return;
+
+        auto deltaBytes = m_history.getDeltaBytes();
+        m_history.resimulate(m_entityComponentManager, m_history.getNewest() - depth,
+                             [](uint64_t, Utilities::PlayerInputs &) {});
+        m_rollbackReport.recordResimulation(Clock::now() - recorded, deltaBytes, m_history.getSize() - 1);
     }
 
-    void waitIfNecessary(int startTime)
+    void exportTelemetry()
     {
-        int endTime = m_renderManager.tick();
-        int timeDiff = endTime - startTime;
-        if (timeDiff < m_screenConfig.ticks_per_frame)
-            m_renderManager.wait(m_screenConfig.ticks_per_frame - timeDiff);
+        if (m_config.telemetryFile.empty())
+            return;
+
+        if (Telemetry::writeCSV(m_entityComponentManager, m_config.telemetryFile))
+            PRINT("TELEMETRY WRITTEN TO", m_config.telemetryFile)
+        else
+            PRINT("FAILED TO WRITE TELEMETRY", m_config.telemetryFile)
     }
 
     void setDeltaTime(float delta)
@@ -110,7 +427,18 @@ class Game
     }
 
   private:
+    RunConfig m_config{};
     ECS::Manager<EntityId> m_entityComponentManager{};
     ScreenConfig m_screenConfig{};
+    FramePacer m_pacer{};
     Renderer::Manager<EntityId> m_renderManager{m_screenConfig};
+    Renderer::RetainedElements<EntityId> m_renderElements{};
+    Renderer::RenderThread<EntityId> m_renderThread{m_renderManager};
+    Renderer::SoftwareRasterizer m_rasterizer{m_screenConfig.width, m_screenConfig.height};
+    Allocations::Counts m_lastAllocations{};
+    Rollback::History m_history{};
+    Rollback::Report m_rollbackReport{};
+    StateHash::Recorder m_stateHash{};
+    Waves::LeakCheck m_waveCheck{};
+    std::unique_ptr<Server> m_server{};
 };
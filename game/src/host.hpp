@@ -0,0 +1,226 @@
+#pragma once
+
+#include "allocations.hpp"
+#include "core.hpp"
+#include "session.hpp"
+#include "trace.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs many independent headless sessions in one process, as a game host would. Sessions only share
+ * the read-only stage layouts and entity constructors; each owns its own world.
+ *
+ * Sessions advance in rounds of a few ticks each, with the workers meeting at a barrier between rounds, so
+ * every session progresses at the same rate no matter which worker runs it.
+ */
+class WorldHost
+{
+  public:
+    // Ticks every session runs before the workers meet
+    static constexpr uint64_t ROUND_TICKS = 16;
+
+    WorldHost(const RunConfig &config) : m_config(config), m_workers(getWorkerCount(config))
+    {
+    }
+
+    /**
+     * @brief Create the sessions and run them all for the given number of ticks, or until every game has
+     * ended. 0 runs until every game has ended.
+     */
+    void run(int ticks)
+    {
+        createSessions();
+        m_tickLimit = static_cast<uint64_t>(std::max(0, ticks));
+
+        auto endRound = [this]() noexcept {
+            ++m_rounds;
+            assignSessions();
+        };
+        std::barrier rounds{static_cast<std::ptrdiff_t>(m_workers.size()), endRound};
+        assignSessions();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads{};
+        for (std::size_t worker = 0; worker < m_workers.size(); ++worker)
+        {
+            threads.emplace_back([&, worker]() {
+                Trace::nameThread(("host worker " + std::to_string(worker)).c_str());
+                isPrintMuted = true;
+                while (m_roundTicks && m_isPlaying)
+                {
+                    runRound(worker);
+                    rounds.arrive_and_wait();
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        m_elapsed = std::chrono::steady_clock::now() - start;
+        m_residentAfterRun = Allocations::getResidentBytes();
+    }
+
+    void printReport() const
+    {
+        uint64_t ticks{}, updateBytes{}, finished{};
+        for (const auto &hosted : m_sessions)
+        {
+            ticks += hosted.session->getTicks();
+            updateBytes += hosted.session->getUpdateBytes();
+            finished += !hosted.isPlaying;
+        }
+        if (!ticks)
+            return;
+
+        double sessions = m_sessions.size();
+        auto isStealing = m_config.hostSchedule == HostSchedule::WORK_STEALING;
+        auto schedule = isStealing ? "work stealing" : "round robin";
+        PRINT("host:", m_sessions.size(), "sessions on", m_workers.size(), schedule, "workers,", finished,
+              "finished")
+        PRINT("host:", ticks, "ticks in", m_elapsed.count(), "s,", ticks / m_elapsed.count(), "ticks/sec,",
+              ticks / sessions / m_elapsed.count(), "ticks/sec per session,", updateBytes / double(ticks),
+              "update bytes/tick")
+        PRINT("host: per session", m_created.bytes / sessions, "bytes allocated creating it,",
+              m_created.count / sessions, "allocations")
+        if (m_residentBefore)
+            PRINT("host: per session", (m_residentCreated - m_residentBefore) / sessions,
+                  "resident bytes when created,", (m_residentAfterRun - m_residentBefore) / sessions,
+                  "after running")
+
+        for (std::size_t worker = 0; worker < m_workers.size(); ++worker)
+            PRINT("host: worker", worker, "ran", m_workers[worker].ticks, "ticks, stole",
+                  m_workers[worker].stolen, "sessions")
+    }
+
+  private:
+    struct HostedSession
+    {
+        std::unique_ptr<Session> session;
+        bool isPlaying{true};
+    };
+
+    // Kept on separate cache lines, as each is written by its own worker and read by thieves
+    struct alignas(64) Worker
+    {
+        std::atomic<std::size_t> next{};
+        std::size_t end{};
+        Utilities::PlayerInputs inputs{};
+        std::vector<uint8_t> update{};
+        uint64_t ticks{};
+        uint64_t stolen{};
+    };
+
+    static std::size_t getWorkerCount(const RunConfig &config)
+    {
+        auto workers = config.hostThreads ? config.hostThreads : std::thread::hardware_concurrency();
+        return std::max(1u, static_cast<unsigned>(workers));
+    }
+
+    void createSessions()
+    {
+        // Sessions log their own creation and every stage change, which is noise at this scale
+        isPrintMuted = true;
+        m_sessions.resize(std::max(1, m_config.hostSessions));
+        m_residentBefore = Allocations::getResidentBytes();
+        auto before = Allocations::get();
+        float step = m_config.simStep ? m_config.simStep : 1.0f / std::max(1, m_config.tickRate);
+        for (auto &hosted : m_sessions)
+        {
+            hosted.session = std::make_unique<Session>(m_config);
+            hosted.session->setDeltaTime(step);
+        }
+        m_created = Allocations::get() - before;
+        m_residentCreated = Allocations::getResidentBytes();
+        isPrintMuted = false;
+
+        for (auto &worker : m_workers)
+        {
+            worker.inputs.resize(std::max(1, m_config.players));
+            for (auto &playerInputs : worker.inputs)
+                playerInputs.reserve(static_cast<int>(Inputs::QUIT) + 1);
+        }
+    }
+
+    /**
+     * @brief Hand out the sessions for the next round. Runs on one thread while the others wait
+     */
+    void assignSessions()
+    {
+        m_isPlaying = std::any_of(m_sessions.begin(), m_sessions.end(),
+                                  [](const HostedSession &hosted) { return hosted.isPlaying; });
+        // The last round only runs the ticks left before the limit
+        auto ticksRun = m_rounds * ROUND_TICKS;
+        auto ticksLeft = m_tickLimit > ticksRun ? m_tickLimit - ticksRun : 0;
+        m_roundTicks = m_tickLimit ? std::min(ROUND_TICKS, ticksLeft) : ROUND_TICKS;
+
+        auto workers = m_workers.size();
+        for (std::size_t worker = 0; worker < workers; ++worker)
+        {
+            m_workers[worker].next = m_sessions.size() * worker / workers;
+            m_workers[worker].end = m_sessions.size() * (worker + 1) / workers;
+        }
+    }
+
+    void runRound(std::size_t worker)
+    {
+        TRACE_SCOPE("WorldHost::round");
+        auto &own = m_workers[worker];
+        if (m_config.hostSchedule == HostSchedule::ROUND_ROBIN)
+        {
+            for (auto i = worker; i < m_sessions.size(); i += m_workers.size())
+                runSession(own, i);
+            return;
+        }
+
+        for (std::size_t i; (i = own.next.fetch_add(1)) < own.end;)
+            runSession(own, i);
+
+        for (std::size_t offset = 1; offset < m_workers.size(); ++offset)
+        {
+            auto &victim = m_workers[(worker + offset) % m_workers.size()];
+            for (std::size_t i; (i = victim.next.fetch_add(1)) < victim.end;)
+            {
+                runSession(own, i);
+                ++own.stolen;
+            }
+        }
+    }
+
+    void runSession(Worker &worker, std::size_t index)
+    {
+        auto &hosted = m_sessions[index];
+        for (uint64_t tick = 0; tick < m_roundTicks && hosted.isPlaying; ++tick)
+        {
+            // Sessions are offset along the autopilot's sweep, so they don't all play the same game
+            auto cycle = static_cast<int>(hosted.session->getTicks() + index * 7);
+            worker.inputs[0].clear();
+            Utilities::addAutopilotInputs(worker.inputs[0], cycle);
+            Utilities::addBotInputs(worker.inputs, cycle);
+            hosted.isPlaying = hosted.session->tick(worker.inputs, worker.update);
+            ++worker.ticks;
+        }
+    }
+
+    RunConfig m_config;
+    std::vector<HostedSession> m_sessions{};
+    std::vector<Worker> m_workers{};
+    // Only written between rounds, while every worker waits at the barrier
+    bool m_isPlaying{true};
+    uint64_t m_rounds{};
+    // Ticks each session runs this round, which is 0 once the limit is reached
+    uint64_t m_roundTicks{};
+    // Ticks each session runs in all, or 0 to run until every game has ended
+    uint64_t m_tickLimit{};
+    Allocations::Counts m_created{};
+    uint64_t m_residentBefore{};
+    uint64_t m_residentCreated{};
+    uint64_t m_residentAfterRun{};
+    std::chrono::duration<double> m_elapsed{};
+};
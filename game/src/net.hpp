@@ -0,0 +1,263 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "render_list.hpp"
+#include "renderer.hpp"
+#include "snapshot.hpp"
+#include "tags.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Messages between the authoritative server and its clients, and the in-process channel standing in
+ * for a socket between them. Clients send their inputs every frame, and the server sends every tick's
+ * changes to the render elements: the positions, sprites and text of the entities which changed.
+ */
+namespace Net
+{
+/**
+ * @brief Ordered queue of byte messages between two threads. Buffers are recycled once received, so steady
+ * traffic doesn't allocate. The queue is bounded: a sender which gets ahead of its receiver waits for room,
+ * so an uncapped server is held to the pace of its client rather than queueing without end.
+ */
+class Channel
+{
+  public:
+    static constexpr std::size_t DEFAULT_CAPACITY{64};
+
+    Channel(std::size_t capacity = DEFAULT_CAPACITY) : m_capacity(capacity)
+    {
+    }
+
+    /**
+     * @brief Queue a message, waiting while the channel is full
+     *
+     * @return bool - Whether the message was queued, false once the channel is closed
+     */
+    bool send(const std::vector<uint8_t> &message)
+    {
+        std::unique_lock lock{m_mutex};
+        m_hasRoom.wait(lock, [this]() { return m_isClosed || m_messages.size() < m_capacity; });
+        if (m_isClosed)
+            return false;
+
+        std::vector<uint8_t> buffer{};
+        if (!m_free.empty())
+        {
+            buffer.swap(m_free.back());
+            m_free.pop_back();
+        }
+        buffer.assign(message.begin(), message.end());
+        m_messages.push_back(std::move(buffer));
+        m_bytes += message.size();
+        ++m_sent;
+
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest message, recycling the buffer it is swapped with
+     *
+     * @return bool - Whether there was a message
+     */
+    bool receive(std::vector<uint8_t> &message)
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            if (m_messages.empty())
+                return false;
+
+            message.swap(m_messages.front());
+            m_free.push_back(std::move(m_messages.front()));
+            m_messages.pop_front();
+        }
+        m_hasRoom.notify_one();
+
+        return true;
+    }
+
+    /**
+     * @brief Stop accepting messages and wake any waiting sender. Queued messages can still be received.
+     */
+    void close()
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_isClosed = true;
+        }
+        m_hasRoom.notify_all();
+    }
+
+    uint64_t getBytes() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_bytes;
+    }
+
+    uint64_t getSent() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_sent;
+    }
+
+  private:
+    mutable std::mutex m_mutex{};
+    std::condition_variable m_hasRoom{};
+    std::size_t m_capacity;
+    bool m_isClosed{false};
+    std::deque<std::vector<uint8_t>> m_messages{};
+    std::vector<std::vector<uint8_t>> m_free{};
+    uint64_t m_bytes{};
+    uint64_t m_sent{};
+};
+
+/**
+ * @brief Inputs are sent as a bitmask of the inputs held or pressed during a client frame
+ */
+inline void encodeInputs(const std::vector<Inputs> &inputs, std::vector<uint8_t> &message)
+{
+    uint32_t mask{};
+    for (const auto &input : inputs)
+        mask |= 1u << static_cast<uint32_t>(input);
+
+    message.clear();
+    Snapshot::Writer{message}.value(mask);
+}
+
+inline uint32_t decodeInputs(const std::vector<uint8_t> &message)
+{
+    return Snapshot::Reader{message}.value<uint32_t>();
+}
+
+inline void expandInputs(uint32_t mask, std::vector<Inputs> &inputs)
+{
+    inputs.clear();
+    for (int input = 0; input <= static_cast<int>(Inputs::QUIT); ++input)
+        if (mask & (1u << input))
+            inputs.push_back(static_cast<Inputs>(input));
+}
+
+enum ElementFlags : uint8_t
+{
+    ERASED = 1 << 0,
+    UI = 1 << 1,
+    TEXT = 1 << 2,
+};
+
+inline void writeElement(Snapshot::Writer &writer, EntityId id, bool isUI,
+                         const Renderer::RenderableElement &element)
+{
+    uint8_t flags = (isUI ? UI : 0) | (element.text.empty() ? 0 : TEXT);
+    writer.value(flags);
+    writer.value(id);
+    writer.value(std::array<float, 4>{element.x, element.y, element.w, element.h});
+    writer.value(element.rgba);
+    if (flags & TEXT)
+        writer.string(element.text);
+}
+
+/**
+ * @brief Encode the render element changes flagged since the last update, consuming the flags the same way
+ * RenderList::sync does. A stale render list is sent whole, with the reset flag set.
+ *
+ * The message is: tick, reset flag, element count, then per element its flags, id, and unless erased its
+ * bounds, colour and text.
+ */
+inline void encodeUpdate(ComponentManager &cm, uint64_t tick, std::vector<uint8_t> &message)
+{
+    message.clear();
+    Snapshot::Writer writer{message};
+    auto [_, renderListComps] = cm.getUnique<RenderListComponent>();
+    auto &tagMasks = TagMask::getMasks(cm);
+    renderListComps.mutate([&](RenderListComponent &renderListComp) {
+        writer.value(tick);
+        writer.value(static_cast<uint8_t>(renderListComp.isStale));
+        auto countOffset = writer.getSize();
+        uint32_t count{};
+        writer.value(count);
+
+        if (renderListComp.isStale)
+        {
+            cm.getGroup<SpriteComponent, PositionComponent>().each(
+                [&](EId eId, auto &spriteComps, auto &positionComps) {
+                    auto isUI = TagMask::hasAny<UIComponent>(tagMasks, eId);
+                    writeElement(writer, eId, isUI,
+                                 RenderList::createElement(cm, eId, isUI, spriteComps, positionComps));
+                    ++count;
+                });
+        }
+        else
+        {
+            // An entity can be flagged several times in a tick, but only needs sending once
+            auto &dirtyIds = renderListComp.dirtyIds;
+            std::sort(dirtyIds.begin(), dirtyIds.end());
+            dirtyIds.erase(std::unique(dirtyIds.begin(), dirtyIds.end()), dirtyIds.end());
+            for (const auto &id : dirtyIds)
+            {
+                auto [spriteComps, positionComps] = cm.get<SpriteComponent, PositionComponent>(id);
+                if (!spriteComps || !positionComps)
+                {
+                    writer.value(static_cast<uint8_t>(ERASED));
+                    writer.value(id);
+                }
+                else
+                {
+                    auto isUI = TagMask::hasAny<UIComponent>(tagMasks, id);
+                    writeElement(writer, id, isUI,
+                                 RenderList::createElement(cm, id, isUI, spriteComps, positionComps));
+                }
+                ++count;
+            }
+        }
+
+        std::memcpy(message.data() + countOffset, &count, sizeof(count));
+        renderListComp.isStale = false;
+        renderListComp.dirtyIds.clear();
+    });
+}
+
+/**
+ * @brief Apply an update from the server to a client's render elements
+ *
+ * @param tick - Set to the server tick the update was sent on
+ *
+ * @return bool - Whether the update was complete
+ */
+inline bool applyUpdate(const std::vector<uint8_t> &message, Renderer::RetainedElements<EntityId> &elements,
+                        uint64_t &tick)
+{
+    Snapshot::Reader reader{message};
+    tick = reader.value<uint64_t>();
+    if (reader.value<uint8_t>())
+        elements.clear();
+
+    auto count = reader.value<uint32_t>();
+    for (uint32_t i = 0; i < count && reader.isOk(); ++i)
+    {
+        auto flags = reader.value<uint8_t>();
+        auto id = reader.value<EntityId>();
+        if (flags & ERASED)
+        {
+            elements.erase(id);
+            continue;
+        }
+
+        auto [x, y, w, h] = reader.value<std::array<float, 4>>();
+        auto rgba = reader.value<Renderer::RGBA>();
+        Renderer::RenderableElement element{x, y, w, h, rgba};
+        if (flags & TEXT)
+            element.text = reader.string();
+        if (reader.isOk())
+            elements.upsert(id, flags & UI, std::move(element));
+    }
+
+    return reader.isOk() && reader.isDone();
+}
+} // namespace Net
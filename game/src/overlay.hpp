@@ -0,0 +1,237 @@
+#pragma once
+
+#include "allocations.hpp"
+#include "components.hpp"
+#include "core.hpp"
+#include "entities.hpp"
+#include "recycler.hpp"
+#include "render_list.hpp"
+#include "tags.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Debug performance overlay, drawn as UI entities through the render list. Shows FPS, a frame time
+ * sparkline, per system milliseconds, the entity count and allocations per frame. System timings are only
+ * measured while the overlay is visible.
+ */
+namespace Overlay
+{
+constexpr std::size_t FRAME_HISTORY = 64;
+// How many frames apart the overlay elements are refreshed
+constexpr uint64_t REFRESH_INTERVAL = 15;
+constexpr std::size_t SYSTEMS_PER_LINE = 3;
+constexpr std::size_t LINE_COUNT = 7;
+constexpr float LINE_HEIGHT = 26;
+constexpr float BAR_WIDTH = 3;
+constexpr float SPARKLINE_HEIGHT = 40;
+
+struct SystemTiming
+{
+    const char *name;
+    float ms;
+};
+
+struct OverlayComponent : Unique
+{
+    std::array<float, FRAME_HISTORY> frameTimes{};
+    uint64_t frames{};
+    Allocations::Counts allocations{};
+    std::vector<SystemTiming> systemTimings{};
+    bool isVisible{};
+
+    OverlayComponent(bool _isVisible) : isVisible(_isVisible)
+    {
+    }
+};
+
+/**
+ * @brief The overlay's UI entities. Snapshots store them along with the rest of the world, while the frame
+ * history and visibility above carry on through a restore
+ */
+struct OverlayElementsComponent : Unique
+{
+    std::vector<EntityId> lineIds{};
+    std::vector<EntityId> barIds{};
+};
+
+inline void enable(ComponentManager &cm, bool isVisible)
+{
+    auto [gameId, _] = cm.getUnique<GameMetaComponent>();
+    cm.add<OverlayComponent>(gameId, isVisible);
+    cm.add<OverlayElementsComponent>(gameId);
+}
+
+/**
+ * @brief Get the buffer this frame's system timings are recorded into, or null while the overlay is hidden
+ */
+inline std::vector<SystemTiming> *getSystemTimings(ComponentManager &cm)
+{
+    std::vector<SystemTiming> *timings{nullptr};
+    auto [_, overlayComps] = cm.getUnique<OverlayComponent>();
+    overlayComps.mutate([&](OverlayComponent &overlayComp) {
+        if (!overlayComp.isVisible)
+            return;
+
+        overlayComp.systemTimings.clear();
+        timings = &overlayComp.systemTimings;
+    });
+
+    return timings;
+}
+
+inline void removeElements(ComponentManager &cm, std::vector<EntityId> &ids)
+{
+    Recycler::destroy(cm, ids);
+    ids.clear();
+}
+
+inline void removeElements(ComponentManager &cm, OverlayElementsComponent &elementsComp)
+{
+    removeElements(cm, elementsComp.lineIds);
+    removeElements(cm, elementsComp.barIds);
+}
+
+inline void toggle(ComponentManager &cm)
+{
+    auto [_, overlayComps] = cm.getUnique<OverlayComponent>();
+    auto [__, elementsComps] = cm.getUnique<OverlayElementsComponent>();
+    overlayComps.mutate([&](OverlayComponent &overlayComp) {
+        overlayComp.isVisible = !overlayComp.isVisible;
+        if (overlayComp.isVisible)
+            return;
+
+        elementsComps.mutate(
+            [&](OverlayElementsComponent &elementsComp) { removeElements(cm, elementsComp); });
+    });
+}
+
+inline void createElements(ComponentManager &cm, OverlayElementsComponent &elementsComp)
+{
+    auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    auto &screen = gameMetaComps.peek(&GameMetaComponent::screen);
+    float tileSize = gameMetaComps.peek(&GameMetaComponent::tileSize);
+
+    for (std::size_t i = 0; i < LINE_COUNT; ++i)
+    {
+        float y = tileSize + LINE_HEIGHT * i;
+        elementsComp.lineIds.push_back(overlayLine(cm, tileSize, y, tileSize, tileSize));
+    }
+
+    // Bars start empty and grow upwards from the bottom of the sparkline
+    float x = screen.x - tileSize - BAR_WIDTH * FRAME_HISTORY;
+    float y = tileSize + SPARKLINE_HEIGHT;
+    for (std::size_t i = 0; i < FRAME_HISTORY; ++i)
+        elementsComp.barIds.push_back(overlayBar(cm, x + BAR_WIDTH * i, y, BAR_WIDTH - 1, 0));
+}
+
+inline void setText(ComponentManager &cm, EntityId id, const std::string &text)
+{
+    auto [textComps] = cm.get<TextComponent>(id);
+    textComps.mutate([&](TextComponent &textComp) { textComp.text = text; });
+    RenderList::markDirty(cm, id);
+}
+
+inline std::string formatMs(float ms)
+{
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%.2f", ms);
+    return buffer;
+}
+
+inline void refreshLines(ComponentManager &cm, OverlayComponent &overlayComp,
+                         const OverlayElementsComponent &elementsComp)
+{
+    float total{}, worst{};
+    for (const auto &frameTime : overlayComp.frameTimes)
+    {
+        total += frameTime;
+        worst = std::max(worst, frameTime);
+    }
+    auto count = std::min<uint64_t>(overlayComp.frames, FRAME_HISTORY);
+    float average = count ? total / count : 0;
+
+    auto &lineIds = elementsComp.lineIds;
+    setText(cm, lineIds[0],
+            "FPS: " + std::to_string(average > 0 ? static_cast<int>(1 / average) : 0) + "  FRAME: " +
+                formatMs(average * 1000) + " MS  WORST: " + formatMs(worst * 1000) + " MS");
+    setText(cm, lineIds[1],
+            "ENTITIES: " + std::to_string(Recycler::getEntityCount(cm)) +
+                "  ALLOCS/FRAME: " + std::to_string(overlayComp.allocations.count) + " (" +
+                std::to_string(overlayComp.allocations.bytes) + " B)");
+
+    for (std::size_t line = 2; line < LINE_COUNT; ++line)
+    {
+        std::string text{};
+        auto first = (line - 2) * SYSTEMS_PER_LINE;
+        auto last = std::min(first + SYSTEMS_PER_LINE, overlayComp.systemTimings.size());
+        for (auto i = first; i < last; ++i)
+        {
+            std::string_view name{overlayComp.systemTimings[i].name};
+            if (name.starts_with("Systems::"))
+                name.remove_prefix(9);
+            text.append(name).append(" ").append(formatMs(overlayComp.systemTimings[i].ms)).append("  ");
+        }
+        setText(cm, lineIds[line], text);
+    }
+}
+
+/**
+ * @brief Scale the bars against the worst frame in the history, oldest on the left
+ */
+inline void refreshSparkline(ComponentManager &cm, const OverlayComponent &overlayComp,
+                             const OverlayElementsComponent &elementsComp)
+{
+    float worst = *std::max_element(overlayComp.frameTimes.begin(), overlayComp.frameTimes.end());
+    for (std::size_t i = 0; i < FRAME_HISTORY; ++i)
+    {
+        auto barId = elementsComp.barIds[i];
+        auto frameTime = overlayComp.frameTimes[(overlayComp.frames + i) % FRAME_HISTORY];
+        float height = worst > 0 ? SPARKLINE_HEIGHT * frameTime / worst : 0;
+
+        auto [positionComps] = cm.get<PositionComponent>(barId);
+        positionComps.mutate([&](PositionComponent &positionComp) {
+            auto [x, y, w, h] = positionComp.bounds.get();
+            positionComp.bounds = Bounds{x, y + h - height, w, height};
+        });
+        RenderList::markDirty(cm, barId);
+    }
+}
+
+/**
+ * @brief Record the last frame's time and allocations, and periodically refresh the visible overlay
+ *
+ * @param frameTime - Measured duration of the last frame in seconds
+ * @param allocations - Allocations made during the last frame
+ */
+inline void recordFrame(ComponentManager &cm, float frameTime, const Allocations::Counts &allocations)
+{
+    auto [_, overlayComps] = cm.getUnique<OverlayComponent>();
+    auto [__, elementsComps] = cm.getUnique<OverlayElementsComponent>();
+    overlayComps.mutate([&](OverlayComponent &overlayComp) {
+        overlayComp.frameTimes[overlayComp.frames++ % FRAME_HISTORY] = frameTime;
+        overlayComp.allocations = allocations;
+        if (overlayComp.frames % REFRESH_INTERVAL)
+            return;
+
+        elementsComps.mutate([&](OverlayElementsComponent &elementsComp) {
+            // A restored snapshot brings back the elements the overlay had at its capture
+            if (!overlayComp.isVisible)
+            {
+                removeElements(cm, elementsComp);
+                return;
+            }
+
+            if (elementsComp.lineIds.empty())
+                createElements(cm, elementsComp);
+
+            refreshLines(cm, overlayComp, elementsComp);
+            refreshSparkline(cm, overlayComp, elementsComp);
+        });
+    });
+}
+} // namespace Overlay
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "core.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+/**
+ * @brief Paces frames against nanosecond deadlines from a steady clock. Waiting is a coarse sleep up to
+ * shortly before the deadline, followed by a spin for the remainder, so the error isn't bound by the
+ * scheduler's sleep granularity. In every mode, each frame's interval is measured against the period, so
+ * the report shows how far uncapped and vsync frames stray from the rate, as well as fixed ones.
+ */
+class FramePacer
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    FramePacer(PacingMode mode = PacingMode::UNCAPPED, int hz = 60) : m_mode(mode)
+    {
+        setRate(hz);
+    }
+
+    void setMode(PacingMode mode)
+    {
+        m_mode = mode;
+    }
+
+    void setRate(int hz)
+    {
+        m_period = std::chrono::nanoseconds{hz > 0 ? 1'000'000'000 / hz : 0};
+    }
+
+    /**
+     * @brief Mark the start of a frame, and measure the time since the previous one and its error
+     */
+    void beginFrame()
+    {
+        auto now = Clock::now();
+        bool isFirst = m_frameStart == Clock::time_point{};
+        m_delta = isFirst ? Clock::duration{0} : now - m_frameStart;
+        m_frameStart = now;
+        if (!isFirst && m_period != Clock::duration{0})
+            recordError(m_delta - m_period);
+
+        // Deadlines advance by whole periods so they don't drift, unless the frame fell behind entirely
+        m_deadline += m_period;
+        if (m_deadline < now)
+            m_deadline = now + m_period;
+    }
+
+    /**
+     * @brief Wait until the current frame's deadline, if pacing requires it
+     */
+    void wait()
+    {
+        if (m_mode != PacingMode::FIXED || m_period == Clock::duration{0})
+            return;
+
+        if (Clock::now() < m_deadline - SPIN_THRESHOLD)
+            std::this_thread::sleep_until(m_deadline - SPIN_THRESHOLD);
+
+        while (Clock::now() < m_deadline)
+            ;
+    }
+
+    /**
+     * @brief Time between the last two frame starts, in seconds
+     */
+    float getDeltaTime() const
+    {
+        return std::chrono::duration<float>(m_delta).count();
+    }
+
+    void printReport() const
+    {
+        if (!m_samples)
+            return;
+
+        using Micros = std::chrono::duration<double, std::micro>;
+        double mean = Micros(m_totalError).count() / m_samples;
+        double variance = m_totalSquaredError / m_samples - mean * mean;
+        PRINT("pacing frame interval error mean:", mean, "us  stddev:", std::sqrt(std::max(variance, 0.0)),
+              "us  max:", Micros(m_maxError).count(), "us  over", m_samples, "frames")
+    }
+
+  private:
+    // Sleeping is only trusted up to this close to the deadline
+    static constexpr Clock::duration SPIN_THRESHOLD = std::chrono::microseconds{1500};
+
+    // Errors are signed, early frames negative, and the max is the largest either way
+    void recordError(Clock::duration error)
+    {
+        double micros = std::chrono::duration<double, std::micro>(error).count();
+        m_totalError += error;
+        m_totalSquaredError += micros * micros;
+        m_maxError = std::max(m_maxError, error < Clock::duration{0} ? -error : error);
+        ++m_samples;
+    }
+
+    PacingMode m_mode;
+    Clock::duration m_period{};
+    Clock::duration m_delta{};
+    Clock::time_point m_frameStart{};
+    Clock::time_point m_deadline{};
+
+    Clock::duration m_totalError{};
+    Clock::duration m_maxError{};
+    double m_totalSquaredError{};
+    int m_samples{};
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include <cstdint>
+
+/**
+ * @brief Deterministic random numbers from a xorshift generator. Its state lives on the game meta component,
+ * so it is saved, restored and replayed along with the rest of the world, unlike std::rand's hidden state.
+ */
+namespace Random
+{
+/**
+ * @brief Advance a generator's state and draw its next number, in the same non-negative range as std::rand.
+ * The state must not be 0
+ */
+inline int next(uint64_t &state)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+
+    return static_cast<int>((state * 0x2545F4914F6CDD1Dull) >> 33);
+}
+
+/**
+ * @brief Draw the simulation's next number
+ */
+inline int next(ComponentManager &cm)
+{
+    int value{};
+    auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    gameMetaComps.mutate([&](GameMetaComponent &gameMeta) { value = next(gameMeta.randomState); });
+
+    return value;
+}
+} // namespace Random
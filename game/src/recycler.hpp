@@ -0,0 +1,106 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "render_list.hpp"
+#include "tags.hpp"
+#include <vector>
+
+/**
+ * @brief Hands out entity ids, and counts the entities alive. The ECS library gives every new entity the next
+ * unused id and can't be wound back, so the recycler counts the ids it hands out itself, and only advances
+ * the library's counter past them. The count is stored in snapshots, so a restored world hands out the same
+ * ids as it did after the capture, both when restored in memory and from a file.
+ *
+ * Runs which recycle ids also hand out the ids of removed entities again, which keeps the game's tables
+ * indexed by entity id bounded by the most entities alive at once. Entities are removed through destroy,
+ * wherever in the frame that happens, but their ids are only released at the end of the frame and handed out
+ * again from the next frame on. Events and the frame's buffers are cleared by then, so nothing made within a
+ * frame sees an id change owner.
+ *
+ * Ids kept across frames are not cleared when their entity goes, and can name an unrelated entity once the
+ * id is reused: a projectile's shooterId outlives the alien that fired it, and the deaths it causes are
+ * credited to that id. Their users only act on ids which are never released while a game is played: score
+ * and powerups only go to players. An expiry queued for a destroyed entity only removes effects of its type
+ * which have elapsed, so on a reused id it only removes an effect which was due to go anyway.
+ */
+namespace Recycler
+{
+/**
+ * @brief Start recycling ids from now on
+ */
+inline void enable(ComponentManager &cm)
+{
+    auto [_, recyclerComps] = cm.getUnique<EntityRecyclerComponent>();
+    recyclerComps.mutate([](EntityRecyclerComponent &recyclerComp) { recyclerComp.isReusing = true; });
+}
+
+/**
+ * @brief Create an entity, reusing a released id when ids are recycled
+ */
+inline EntityId create(ComponentManager &cm)
+{
+    EntityId id{};
+    auto [_, recyclerComps] = cm.getUnique<EntityRecyclerComponent>();
+    recyclerComps.mutate([&](EntityRecyclerComponent &recyclerComp) {
+        ++recyclerComp.entityCount;
+        if (!recyclerComp.freeIds.empty())
+        {
+            id = recyclerComp.freeIds.back();
+            recyclerComp.freeIds.pop_back();
+            return;
+        }
+
+        id = ++recyclerComp.highestId;
+        while (recyclerComp.reservedId < id)
+            recyclerComp.reservedId = cm.createEntity();
+    });
+
+    return id;
+}
+
+/**
+ * @brief Remove an entity along with its tags, take it off the render list, and release its id at the end of
+ * the frame when ids are recycled
+ */
+inline void destroy(ComponentManager &cm, EntityId id)
+{
+    TagMask::clear(cm, id);
+    cm.remove(id);
+    RenderList::markDirty(cm, id);
+    auto [_, recyclerComps] = cm.getUnique<EntityRecyclerComponent>();
+    recyclerComps.mutate([&](EntityRecyclerComponent &recyclerComp) {
+        --recyclerComp.entityCount;
+        if (recyclerComp.isReusing)
+            recyclerComp.releasedIds.push_back(id);
+    });
+}
+
+inline void destroy(ComponentManager &cm, const std::vector<EntityId> &ids)
+{
+    for (const auto &id : ids)
+        destroy(cm, id);
+}
+
+/**
+ * @brief Get the count of entities alive
+ */
+inline uint32_t getEntityCount(ComponentManager &cm)
+{
+    auto [_, recyclerComps] = cm.getUnique<EntityRecyclerComponent>();
+    return recyclerComps ? recyclerComps.peek(&EntityRecyclerComponent::entityCount) : 0;
+}
+
+/**
+ * @brief Make the ids released this frame available to be handed out. Run at the end of the frame
+ */
+inline void flush(ComponentManager &cm)
+{
+    auto [_, recyclerComps] = cm.getUnique<EntityRecyclerComponent>();
+    recyclerComps.mutate([&](EntityRecyclerComponent &recyclerComp) {
+        auto &releasedIds = recyclerComp.releasedIds;
+        recyclerComp.freeIds.insert(recyclerComp.freeIds.end(), releasedIds.begin(), releasedIds.end());
+        releasedIds.clear();
+    });
+}
+} // namespace Recycler
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "renderer.hpp"
+#include "tags.hpp"
+
+/**
+ * @brief Keeps the retained render elements in sync with the entities they are built from. Only entities
+ * flagged as dirty are rebuilt, unless the whole list has been flagged as stale.
+ */
+namespace RenderList
+{
+/**
+ * @brief Flag an entity whose position, sprite or text changed, or which was created or removed
+ */
+inline void markDirty(ComponentManager &cm, EntityId id)
+{
+    auto [_, renderListComps] = cm.getUnique<RenderListComponent>();
+    renderListComps.mutate(
+        [&](RenderListComponent &renderListComp) { renderListComp.dirtyIds.push_back(id); });
+}
+
+/**
+ * @brief Flag the whole list to be rebuilt, eg. when a stage is loaded
+ */
+inline void markStale(ComponentManager &cm)
+{
+    auto [_, renderListComps] = cm.getUnique<RenderListComponent>();
+    renderListComps.mutate([&](RenderListComponent &renderListComp) { renderListComp.isStale = true; });
+}
+
+inline Renderer::RenderableElement createElement(ComponentManager &cm, EId eId, bool isUI, auto &spriteComps,
+                                                 auto &positionComps)
+{
+    auto &rgba = spriteComps.peek(&SpriteComponent::rgba);
+    auto [x, y, w, h] = positionComps.peek(&PositionComponent::bounds).get();
+    Renderer::RenderableElement renderEl{x, y, w, h, rgba};
+    if (!isUI)
+        return renderEl;
+
+    auto [textComps] = cm.get<TextComponent>(eId);
+    textComps.inspect([&](const TextComponent &textComp) {
+        renderEl.text = textComp.text;
+        renderEl.rgba = Renderer::RGBA{255, 255, 255, 255};
+    });
+
+    return renderEl;
+}
+
+inline void rebuild(ComponentManager &cm, Renderer::RetainedElements<EntityId> &elements)
+{
+    elements.clear();
+    auto &tagMasks = TagMask::getMasks(cm);
+    cm.getGroup<SpriteComponent, PositionComponent>().each(
+        [&](EId eId, auto &spriteComps, auto &positionComps) {
+            auto isUI = TagMask::hasAny<UIComponent>(tagMasks, eId);
+            elements.upsert(eId, isUI, createElement(cm, eId, isUI, spriteComps, positionComps));
+        });
+}
+
+inline void updateEntity(ComponentManager &cm, Renderer::RetainedElements<EntityId> &elements,
+                         const std::vector<uint32_t> &tagMasks, EId eId)
+{
+    auto [spriteComps, positionComps] = cm.get<SpriteComponent, PositionComponent>(eId);
+    if (!spriteComps || !positionComps)
+    {
+        elements.erase(eId);
+        return;
+    }
+
+    auto isUI = TagMask::hasAny<UIComponent>(tagMasks, eId);
+    elements.upsert(eId, isUI, createElement(cm, eId, isUI, spriteComps, positionComps));
+}
+
+/**
+ * @brief Apply all changes flagged since the last sync to the retained elements
+ */
+inline void sync(ComponentManager &cm, Renderer::RetainedElements<EntityId> &elements)
+{
+    auto [_, renderListComps] = cm.getUnique<RenderListComponent>();
+    auto &tagMasks = TagMask::getMasks(cm);
+    renderListComps.mutate([&](RenderListComponent &renderListComp) {
+        if (renderListComp.isStale)
+            rebuild(cm, elements);
+        else
+            for (const auto &id : renderListComp.dirtyIds)
+                updateEntity(cm, elements, tagMasks, id);
+
+        renderListComp.isStale = false;
+        renderListComp.dirtyIds.clear();
+    });
+}
+}; // namespace RenderList
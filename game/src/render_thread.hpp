@@ -0,0 +1,193 @@
+#pragma once
+
+#include "core.hpp"
+#include "renderer.hpp"
+#include "trace.hpp"
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace Renderer
+{
+/**
+ * @brief Lock-free single producer, single consumer triple buffer. The producer always has a back buffer to
+ * write into, and the consumer always reads the most recently published buffer without blocking.
+ */
+template <typename T> class TripleBuffer
+{
+  public:
+    T &back()
+    {
+        return m_buffers[m_back];
+    }
+
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | DIRTY) & INDEX;
+    }
+
+    /**
+     * @brief Swap in the latest published buffer
+     *
+     * @return bool - Whether a new buffer has been published since the last acquire
+     */
+    bool acquire()
+    {
+        if (!(m_middle.load() & DIRTY))
+            return false;
+
+        m_front = m_middle.exchange(m_front) & INDEX;
+        return true;
+    }
+
+    const T &front() const
+    {
+        return m_buffers[m_front];
+    }
+
+  private:
+    static constexpr uint8_t INDEX = 0b011;
+    static constexpr uint8_t DIRTY = 0b100;
+
+    std::array<T, 3> m_buffers{};
+    uint8_t m_back{0};
+    uint8_t m_front{1};
+    std::atomic<uint8_t> m_middle{2};
+};
+
+/**
+ * @brief Immutable copy of everything needed to draw one simulation tick
+ */
+struct FrameSnapshot
+{
+    std::vector<RenderableElement> world{};
+    std::vector<RenderableElement> ui{};
+    uint64_t tick{};
+};
+
+/**
+ * @brief Held inputs are sampled as a bitmask, so the simulation sees them on every tick no matter how often
+ * the render thread polls. One-shot inputs are latched until consumed.
+ */
+class InputState
+{
+  public:
+    void publish(const std::vector<Inputs> &inputs)
+    {
+        uint32_t held{0};
+        for (const auto &input : inputs)
+            held |= toBit(input);
+
+        m_latched.fetch_or(held & LATCHED);
+        m_held.store(held & ~LATCHED);
+    }
+
+    void consume(std::vector<Inputs> &inputs)
+    {
+        inputs.clear();
+        uint32_t mask = m_held.load() | m_latched.exchange(0);
+        for (int input = 0; input <= static_cast<int>(Inputs::QUIT); ++input)
+            if (mask & (1u << input))
+                inputs.push_back(static_cast<Inputs>(input));
+    }
+
+  private:
+    static constexpr uint32_t toBit(Inputs input)
+    {
+        return 1u << static_cast<uint32_t>(input);
+    }
+
+    static constexpr uint32_t LATCHED = (1u << static_cast<uint32_t>(Inputs::QUIT)) |
+                                        (1u << static_cast<uint32_t>(Inputs::MENU)) |
+                                        (1u << static_cast<uint32_t>(Inputs::TRACE)) |
+                                        (1u << static_cast<uint32_t>(Inputs::OVERLAY)) |
+                                        (1u << static_cast<uint32_t>(Inputs::SAVE)) |
+                                        (1u << static_cast<uint32_t>(Inputs::LOAD));
+
+    std::atomic<uint32_t> m_held{0};
+    std::atomic<uint32_t> m_latched{0};
+};
+
+/**
+ * @brief Owns SDL on a dedicated thread. The window, renderer and event pump all live on this thread, as SDL
+ * requires, while the simulation publishes snapshots and reads inputs from another.
+ */
+template <typename EntityId> class RenderThread
+{
+  public:
+    RenderThread(Manager<EntityId> &manager) : m_manager(manager)
+    {
+    }
+
+    ~RenderThread()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        m_running = true;
+        m_thread = std::thread([this]() { loop(); });
+    }
+
+    void stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    /**
+     * @brief Copy the current render elements into the back buffer and hand them to the render thread
+     */
+    void publish(const RetainedElements<EntityId> &elements, uint64_t tick)
+    {
+        auto &snapshot = m_snapshots.back();
+        snapshot.world.assign(elements.world().begin(), elements.world().end());
+        snapshot.ui.assign(elements.ui().begin(), elements.ui().end());
+        snapshot.tick = tick;
+        m_snapshots.publish();
+    }
+
+    void consumeInputs(std::vector<Inputs> &inputs)
+    {
+        m_inputs.consume(inputs);
+    }
+
+  private:
+    void loop()
+    {
+        Trace::nameThread("render");
+        if (!m_manager.init() || !m_manager.startRender())
+        {
+            m_inputs.publish({Inputs::QUIT});
+            return;
+        }
+
+        while (m_running)
+        {
+            m_manager.pollInputs(m_polledInputs);
+            m_inputs.publish(m_polledInputs);
+
+            if (!m_snapshots.acquire())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            auto &snapshot = m_snapshots.front();
+            m_manager.clear();
+            m_manager.render(snapshot.world, snapshot.ui);
+        }
+
+        m_manager.exit();
+    }
+
+    Manager<EntityId> &m_manager;
+    TripleBuffer<FrameSnapshot> m_snapshots{};
+    InputState m_inputs{};
+    std::vector<Inputs> m_polledInputs{};
+    std::atomic<bool> m_running{false};
+    std::thread m_thread{};
+};
+} // namespace Renderer
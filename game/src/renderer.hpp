@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core.hpp"
+#include "trace.hpp"
 #include <SDL2/SDL.h>
 #include <SDL_render.h>
 #include <SDL_stdinc.h>
@@ -8,9 +9,13 @@
 #include <SDL_ttf.h>
 #include <cstddef>
 #include <cstdint>
+#include <array>
 #include <filesystem>
 #include <iostream>
+#include <list>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 
 namespace Renderer
 {
@@ -29,14 +34,315 @@ struct RenderableElement
 {
     float x, y, w, h;
     RGBA rgba;
-    std::string_view text;
+    std::string text;
 
-    RenderableElement(float _x, float _y, float _w, float _h, RGBA _rgba, std::string_view _text = "")
-        : x(_x), y(_y), w(_w), h(_h), rgba(_rgba), text(_text)
+    RenderableElement(float _x, float _y, float _w, float _h, RGBA _rgba, std::string _text = "")
+        : x(_x), y(_y), w(_w), h(_h), rgba(_rgba), text(std::move(_text))
     {
     }
 };
 
+/**
+ * @brief Persistent world and UI element lists, updated per entity instead of being rebuilt every frame.
+ * Elements are swap-removed, so draw order within a layer is not stable.
+ */
+template <typename EntityId> class RetainedElements
+{
+  public:
+    void upsert(EntityId id, bool isUI, RenderableElement element)
+    {
+        auto found = m_slots.find(id);
+        if (found != m_slots.end() && found->second.isUI != isUI)
+        {
+            erase(id);
+            found = m_slots.end();
+        }
+
+        if (found != m_slots.end())
+        {
+            getLayer(isUI).elements[found->second.index] = std::move(element);
+            return;
+        }
+
+        auto &layer = getLayer(isUI);
+        m_slots.emplace(id, Slot{isUI, layer.elements.size()});
+        layer.elements.push_back(std::move(element));
+        layer.owners.push_back(id);
+    }
+
+    void erase(EntityId id)
+    {
+        auto found = m_slots.find(id);
+        if (found == m_slots.end())
+            return;
+
+        auto [isUI, index] = found->second;
+        m_slots.erase(found);
+
+        auto &layer = getLayer(isUI);
+        if (index != layer.elements.size() - 1)
+        {
+            layer.elements[index] = std::move(layer.elements.back());
+            layer.owners[index] = layer.owners.back();
+            m_slots[layer.owners[index]].index = index;
+        }
+
+        layer.elements.pop_back();
+        layer.owners.pop_back();
+    }
+
+    void clear()
+    {
+        m_slots.clear();
+        m_world = {};
+        m_ui = {};
+    }
+
+    const std::vector<RenderableElement> &world() const
+    {
+        return m_world.elements;
+    }
+
+    const std::vector<RenderableElement> &ui() const
+    {
+        return m_ui.elements;
+    }
+
+  private:
+    struct Slot
+    {
+        bool isUI;
+        std::size_t index;
+    };
+
+    struct Layer
+    {
+        std::vector<RenderableElement> elements{};
+        std::vector<EntityId> owners{};
+    };
+
+    Layer &getLayer(bool isUI)
+    {
+        return isUI ? m_ui : m_world;
+    }
+
+    std::unordered_map<EntityId, Slot> m_slots{};
+    Layer m_world{};
+    Layer m_ui{};
+};
+
+/**
+ * @brief Printable ASCII glyphs rasterized once into a single white texture. Text is drawn by copying glyph
+ * rects out of the atlas with a color mod, instead of rasterizing whole strings.
+ */
+class GlyphAtlas
+{
+  public:
+    static constexpr char FIRST_GLYPH = ' ';
+    static constexpr char LAST_GLYPH = '~';
+
+    struct Glyph
+    {
+        SDL_Rect rect{};
+        int advance{};
+    };
+
+    bool build(SDL_Renderer *renderer, TTF_Font *font)
+    {
+        destroy();
+        if (!renderer || !font)
+            return false;
+
+        SDL_Color white{255, 255, 255, 255};
+        std::array<SDL_Surface *, LAST_GLYPH - FIRST_GLYPH + 1> surfaces{};
+        int width{0};
+        for (char c = FIRST_GLYPH; c <= LAST_GLYPH; ++c)
+        {
+            auto &glyph = m_glyphs[c - FIRST_GLYPH];
+            auto *surface = TTF_RenderGlyph_Solid(font, c, white);
+            TTF_GlyphMetrics(font, c, nullptr, nullptr, nullptr, nullptr, &glyph.advance);
+            surfaces[c - FIRST_GLYPH] = surface;
+            if (!surface)
+                continue;
+
+            glyph.rect = SDL_Rect{width, 0, surface->w, surface->h};
+            width += surface->w;
+            m_height = std::max(m_height, surface->h);
+        }
+
+        SDL_Surface *atlas = nullptr;
+        if (width && m_height)
+            atlas = SDL_CreateRGBSurfaceWithFormat(0, width, m_height, 32, SDL_PIXELFORMAT_RGBA32);
+
+        for (std::size_t i = 0; i < surfaces.size(); ++i)
+        {
+            if (!surfaces[i])
+                continue;
+
+            if (atlas)
+            {
+                SDL_Rect dest = m_glyphs[i].rect;
+                SDL_BlitSurface(surfaces[i], nullptr, atlas, &dest);
+            }
+            SDL_FreeSurface(surfaces[i]);
+        }
+
+        if (!atlas)
+            return false;
+
+        m_texture = SDL_CreateTextureFromSurface(renderer, atlas);
+        SDL_FreeSurface(atlas);
+        if (!m_texture)
+            return false;
+
+        SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+        return true;
+    }
+
+    bool covers(std::string_view text) const
+    {
+        if (!m_texture)
+            return false;
+
+        for (const auto &c : text)
+            if (c < FIRST_GLYPH || c > LAST_GLYPH)
+                return false;
+
+        return true;
+    }
+
+    int measure(std::string_view text) const
+    {
+        int width{0};
+        for (const auto &c : text)
+            width += m_glyphs[c - FIRST_GLYPH].advance;
+
+        return width;
+    }
+
+    /**
+     * @brief Copy the glyphs of the text onto the current render target, starting at x, y
+     */
+    void draw(SDL_Renderer *renderer, std::string_view text, const RGBA &rgba, int x, int y) const
+    {
+        SDL_SetTextureColorMod(m_texture, rgba.r, rgba.g, rgba.b);
+        SDL_SetTextureAlphaMod(m_texture, rgba.a);
+        for (const auto &c : text)
+        {
+            const auto &glyph = m_glyphs[c - FIRST_GLYPH];
+            SDL_Rect dest{x, y, glyph.rect.w, glyph.rect.h};
+            SDL_RenderCopy(renderer, m_texture, &glyph.rect, &dest);
+            x += glyph.advance;
+        }
+    }
+
+    int height() const
+    {
+        return m_height;
+    }
+
+    void destroy()
+    {
+        if (m_texture)
+            SDL_DestroyTexture(m_texture);
+
+        m_texture = nullptr;
+        m_height = 0;
+        m_glyphs = {};
+    }
+
+  private:
+    std::array<Glyph, LAST_GLYPH - FIRST_GLYPH + 1> m_glyphs{};
+    SDL_Texture *m_texture{nullptr};
+    int m_height{0};
+};
+
+/**
+ * @brief Least recently used cache of fully composed text textures, keyed by text and color. Lookups view the
+ * element's text, so only inserting an entry copies it
+ */
+class TextCache
+{
+  public:
+    struct Key
+    {
+        std::string_view text;
+        uint32_t rgba;
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const
+        {
+            return std::hash<std::string_view>{}(key.text) ^ (key.rgba * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    struct Entry
+    {
+        std::string text;
+        uint32_t rgba{};
+        SDL_Texture *texture{nullptr};
+        int w{}, h{};
+    };
+
+    static Key makeKey(std::string_view text, const RGBA &rgba)
+    {
+        return Key{text, static_cast<uint32_t>(rgba.r) << 24 | static_cast<uint32_t>(rgba.g) << 16 |
+                             static_cast<uint32_t>(rgba.b) << 8 | rgba.a};
+    }
+
+    TextCache(std::size_t capacity = 32) : m_capacity(capacity)
+    {
+    }
+
+    const Entry *find(const Key &key)
+    {
+        auto found = m_index.find(key);
+        if (found == m_index.end())
+            return nullptr;
+
+        // Move to the front to mark as most recently used
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        return &*found->second;
+    }
+
+    const Entry *insert(const Key &key, SDL_Texture *texture, int w, int h)
+    {
+        if (m_entries.size() >= m_capacity)
+            evict();
+
+        // The index views the entry's own copy of the text, which stays put as list nodes never move
+        auto &entry = m_entries.emplace_front(Entry{std::string{key.text}, key.rgba, texture, w, h});
+        m_index[Key{entry.text, entry.rgba}] = m_entries.begin();
+        return &entry;
+    }
+
+    void clear()
+    {
+        for (auto &entry : m_entries)
+            SDL_DestroyTexture(entry.texture);
+
+        m_entries.clear();
+        m_index.clear();
+    }
+
+  private:
+    void evict()
+    {
+        auto &last = m_entries.back();
+        SDL_DestroyTexture(last.texture);
+        m_index.erase(Key{last.text, last.rgba});
+        m_entries.pop_back();
+    }
+
+    std::size_t m_capacity;
+    std::list<Entry> m_entries{};
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index{};
+};
+
 template <typename EntityId> class Manager
 {
   public:
@@ -49,6 +355,14 @@ template <typename EntityId> class Manager
         exit();
     }
 
+    /**
+     * @brief Whether presenting should wait for the display refresh. Must be set before startRender
+     */
+    void setVsync(bool isVsync)
+    {
+        m_isVsync = isVsync;
+    }
+
     bool init()
     {
         TTF_Init();
@@ -76,17 +390,27 @@ template <typename EntityId> class Manager
         SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
         SDL_SetRenderDrawColor(m_renderer, 0xFF, 0xFF, 0xFF, 0xFF);
 
+        // The atlas is a texture, so it can only be built once the renderer exists
+        if (!m_glyphAtlas.build(m_renderer, m_font))
+            printError("Glyph atlas could not be built, falling back to per-string text rendering");
+
         return true;
     }
 
     /**
-     * @brief Render the elements passed in
+     * @brief Render the elements passed in. UI elements are last to ensure they are overlaid on top
      *
-     * @param renderElements Container of renderable element configs
+     * @param worldElements Container of renderable game element configs
+     * @param uiElements Container of renderable UI element configs
      */
-    void render(std::vector<RenderableElement> &renderElements)
+    void render(const std::vector<RenderableElement> &worldElements,
+                const std::vector<RenderableElement> &uiElements)
     {
-        for (const auto &element : renderElements)
+        TRACE_SCOPE("Renderer::render");
+        for (const auto &element : worldElements)
+            renderTile(element);
+
+        for (const auto &element : uiElements)
             renderTile(element);
 
         SDL_RenderPresent(m_renderer);
@@ -97,9 +421,12 @@ template <typename EntityId> class Manager
      *
      * @return Container of inputs
      */
-    std::vector<Inputs> pollInputs()
+    /**
+     * @brief Replace the contents of the inputs with the current events and key states
+     */
+    void pollInputs(std::vector<Inputs> &inputs)
     {
-        std::vector<Inputs> inputs;
+        inputs.clear();
         while (SDL_PollEvent(&m_event))
         {
             if (m_event.type == SDL_QUIT)
@@ -107,6 +434,18 @@ template <typename EntityId> class Manager
                 inputs.push_back(Inputs::QUIT);
                 continue;
             }
+
+            if (m_event.type != SDL_KEYDOWN || m_event.key.repeat)
+                continue;
+
+            if (m_event.key.keysym.scancode == SDL_SCANCODE_F9)
+                inputs.push_back(Inputs::TRACE);
+            else if (m_event.key.keysym.scancode == SDL_SCANCODE_F3)
+                inputs.push_back(Inputs::OVERLAY);
+            else if (m_event.key.keysym.scancode == SDL_SCANCODE_F5)
+                inputs.push_back(Inputs::SAVE);
+            else if (m_event.key.keysym.scancode == SDL_SCANCODE_F8)
+                inputs.push_back(Inputs::LOAD);
         }
 
         const Uint8 *keyStates = SDL_GetKeyboardState(NULL);
@@ -117,12 +456,12 @@ template <typename EntityId> class Manager
             inputs.push_back(Inputs::RIGHT);
         if (keyStates[SDL_SCANCODE_SPACE])
             inputs.push_back(Inputs::SHOOT);
-
-        return inputs;
     }
 
     void exit()
     {
+        m_textCache.clear();
+        m_glyphAtlas.destroy();
         SDL_DestroyRenderer(m_renderer);
         SDL_DestroyWindow(m_window);
 
@@ -159,7 +498,8 @@ template <typename EntityId> class Manager
         if (!m_window)
             return false;
 
-        m_renderer = SDL_CreateRenderer(m_window, false, SDL_RENDERER_ACCELERATED);
+        Uint32 flags = SDL_RENDERER_ACCELERATED | (m_isVsync ? SDL_RENDERER_PRESENTVSYNC : 0);
+        m_renderer = SDL_CreateRenderer(m_window, false, flags);
 
         return m_renderer ? true : false;
     }
@@ -178,41 +518,81 @@ template <typename EntityId> class Manager
         return true;
     }
 
-    void renderText(SDL_Renderer *renderer, const RenderableElement &re, const SDL_Rect &rect)
+    /**
+     * @brief Compose the text into its own texture from the glyph atlas, or rasterize it directly if the
+     * atlas can't be used
+     */
+    SDL_Texture *createTextTexture(SDL_Renderer *renderer, const RenderableElement &re, int &w, int &h)
     {
-        const auto &text = re.text;
+        auto &text = re.text;
+        if (m_glyphAtlas.covers(text) && SDL_RenderTargetSupported(renderer))
+        {
+            w = m_glyphAtlas.measure(text);
+            h = m_glyphAtlas.height();
+            SDL_Texture *texture =
+                SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+            if (texture)
+            {
+                SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+                SDL_SetRenderTarget(renderer, texture);
+                setInvisibleRenderColor();
+                SDL_RenderClear(renderer);
+                m_glyphAtlas.draw(renderer, text, re.rgba, 0, 0);
+                SDL_SetRenderTarget(renderer, nullptr);
+
+                return texture;
+            }
+        }
+
         auto [r, g, b, a] = re.rgba;
         SDL_Color color = {r, g, b, a};
 
-        if (text.empty() || !m_font)
-            return;
-
-        SDL_Surface *surface = TTF_RenderText_Solid(m_font, text.data(), color);
+        // TTF takes a null terminated string, which the element's own text is
+        SDL_Surface *surface = TTF_RenderText_Solid(m_font, re.text.c_str(), color);
         if (!surface)
-            return;
+            return nullptr;
 
         SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-        if (!texture)
-        {
-            SDL_FreeSurface(surface);
+        w = surface->w;
+        h = surface->h;
+        SDL_FreeSurface(surface);
+
+        return texture;
+    }
+
+    void renderText(SDL_Renderer *renderer, const RenderableElement &re, const SDL_Rect &rect)
+    {
+        if (re.text.empty() || !m_font)
             return;
+
+        auto key = TextCache::makeKey(re.text, re.rgba);
+        auto *entry = m_textCache.find(key);
+        if (!entry)
+        {
+            int w{}, h{};
+            SDL_Texture *texture = createTextTexture(renderer, re, w, h);
+            if (!texture)
+                return;
+
+            entry = m_textCache.insert(key, texture, w, h);
         }
 
-        SDL_Rect textRect = {rect.x, rect.y + (rect.h - surface->h) / 2, surface->w, surface->h};
-        SDL_RenderCopy(renderer, texture, nullptr, &textRect);
-        SDL_DestroyTexture(texture);
-        SDL_FreeSurface(surface);
+        SDL_Rect textRect = {rect.x, rect.y + (rect.h - entry->h) / 2, entry->w, entry->h};
+        SDL_RenderCopy(renderer, entry->texture, nullptr, &textRect);
     }
 
     void renderTile(const RenderableElement &re)
     {
         auto tile = createRectangle(re.x, re.y, re.w, re.h);
+
+        // Text first, as composing new text textures changes the render target and draw color
+        renderText(m_renderer, re, tile);
+
         if (re.text.empty())
             setRenderColor(re.rgba);
         else
             setInvisibleRenderColor();
 
-        renderText(m_renderer, re, tile);
         renderSolidRect(tile);
     }
 
@@ -243,5 +623,8 @@ template <typename EntityId> class Manager
     ScreenConfig m_screen;
     SDL_Renderer *m_renderer;
     TTF_Font *m_font;
+    bool m_isVsync{false};
+    GlyphAtlas m_glyphAtlas{};
+    TextCache m_textCache{};
 };
 } // namespace Renderer
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "tags.hpp"
+
+/**
+ * @brief Handles to the unique components systems read throughout a frame.  They are resolved once at the
+ * start of each update, so systems don't look them up again inside their per entity loops
+ */
+struct Resources
+{
+    EntityId gameId;
+    ECS::Components<GameComponent> game;
+    ECS::Components<GameMetaComponent> gameMeta;
+    EntityId startTriggerId;
+    ECS::Components<TagMaskComponent> tagMasks;
+
+    static Resources resolve(ComponentManager &cm)
+    {
+        auto [gameId, gameComps] = cm.getUnique<GameComponent>();
+        auto [gameMetaId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+        auto [startTriggerId, startTriggerComps] = cm.getUnique<StartGameTriggerComponent>();
+        auto [tagMaskId, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+
+        return Resources{gameId, gameComps, gameMetaComps, startTriggerId, tagMaskComps};
+    }
+
+    const std::vector<uint32_t> &getTagMasks()
+    {
+        return tagMasks.peek(&TagMaskComponent::masks);
+    }
+
+    double getSimTime()
+    {
+        return gameMeta.peek(&GameMetaComponent::simTime);
+    }
+
+    /**
+     * @brief Speed and attack rate modifier for the current stage, which is cached when the stage is loaded
+     */
+    float getDifficultyModifier()
+    {
+        return game.peek(&GameComponent::difficultyModifier);
+    }
+};
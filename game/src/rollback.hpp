@@ -0,0 +1,318 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "snapshot.hpp"
+#include "trace.hpp"
+#include "update.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief History of the last ticks' world states and inputs, for rewinding to an earlier tick and simulating
+ * forward again with corrected inputs, as rollback netplay does.
+ *
+ * Only the newest state is held as a full snapshot. Every older tick is held as a delta which rebuilds its
+ * snapshot from the following tick's, so recording costs a capture and a diff, and rewinding a few ticks
+ * costs a patch per tick and a single restore.
+ */
+namespace Rollback
+{
+constexpr std::size_t HISTORY_TICKS = 32;
+// Matching stretches shorter than an op header are stored as literal bytes rather than copied
+constexpr uint32_t COPY_MIN = 2 * sizeof(uint32_t);
+
+template <typename T> inline void append(std::vector<uint8_t> &bytes, T value)
+{
+    auto *data = reinterpret_cast<const uint8_t *>(&value);
+    bytes.insert(bytes.end(), data, data + sizeof(T));
+}
+
+template <typename T> inline T take(const uint8_t *&pos)
+{
+    T value;
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+inline uint32_t getSectionEnd(const Snapshot::Sections &sections, std::size_t section, std::size_t size)
+{
+    return section + 1 < sections.size() ? sections[section + 1] : static_cast<uint32_t>(size);
+}
+
+/**
+ * @brief Encode how to rebuild the older bytes from the newer ones: the older size, followed by ops which
+ * either copy a stretch of the newer bytes or hold literal bytes. Each op starts with its length shifted
+ * left, and the low bit set for literals.
+ *
+ * Each type's section of the older bytes is compared against the same type's section of the newer ones, so a
+ * type which gained or lost components doesn't misalign every type after it.
+ */
+inline void diff(const std::vector<uint8_t> &newer, const Snapshot::Sections &newerSections,
+                 const std::vector<uint8_t> &older, const Snapshot::Sections &olderSections,
+                 std::vector<uint8_t> &delta)
+{
+    delta.clear();
+    append(delta, static_cast<uint32_t>(older.size()));
+
+    for (std::size_t section = 0; section < olderSections.size(); ++section)
+    {
+        uint32_t olderStart = olderSections[section];
+        uint32_t length = getSectionEnd(olderSections, section, older.size()) - olderStart;
+        uint32_t newerStart{}, shared{};
+        if (section < newerSections.size())
+        {
+            newerStart = newerSections[section];
+            shared = std::min(length, getSectionEnd(newerSections, section, newer.size()) - newerStart);
+        }
+
+        auto countSame = [&](uint32_t i, uint32_t limit) {
+            uint32_t count{};
+            while (i + count < shared && count < limit &&
+                   older[olderStart + i + count] == newer[newerStart + i + count])
+                ++count;
+            return count;
+        };
+
+        uint32_t i = 0;
+        while (i < length)
+        {
+            auto same = countSame(i, length);
+            if (same >= COPY_MIN)
+            {
+                append(delta, same << 1);
+                append(delta, newerStart + i);
+                i += same;
+                continue;
+            }
+
+            auto literalStart = i;
+            while (i < length && (same = countSame(i, COPY_MIN)) < COPY_MIN)
+                i += std::max(same, 1u);
+
+            append(delta, (i - literalStart) << 1 | 1);
+            auto literal = older.begin() + olderStart;
+            delta.insert(delta.end(), literal + literalStart, literal + i);
+        }
+    }
+}
+
+/**
+ * @brief Rebuild the older bytes from the newer ones and a delta from diff
+ */
+inline void patch(const std::vector<uint8_t> &newer, const std::vector<uint8_t> &delta,
+                  std::vector<uint8_t> &older)
+{
+    const uint8_t *pos = delta.data();
+    const uint8_t *end = pos + delta.size();
+    older.resize(take<uint32_t>(pos));
+    uint8_t *out = older.data();
+    while (pos < end)
+    {
+        auto op = take<uint32_t>(pos);
+        auto length = op >> 1;
+        if (op & 1)
+        {
+            std::memcpy(out, pos, length);
+            pos += length;
+        }
+        else
+            std::memcpy(out, newer.data() + take<uint32_t>(pos), length);
+        out += length;
+    }
+}
+
+struct Tick
+{
+    Utilities::PlayerInputs inputs{};
+    // The step this tick's update was run with
+    float deltaTime{};
+    // Rebuilds this tick's state from the following tick's
+    std::vector<uint8_t> delta{};
+};
+
+/**
+ * @brief Ring of recorded ticks. Buffers are reused as the ring wraps, so recording stops allocating once
+ * they have grown to fit.
+ */
+class History
+{
+  public:
+    History(std::size_t capacity = HISTORY_TICKS) : m_ticks(capacity)
+    {
+    }
+
+    /**
+     * @brief Record the world's state before the coming tick's update, and the inputs it is run with
+     */
+    void record(ComponentManager &cm, const Utilities::PlayerInputs &inputs)
+    {
+        auto &recorded = getTick(m_end).inputs;
+        recorded.resize(inputs.size());
+        for (std::size_t player = 0; player < inputs.size(); ++player)
+        {
+            recorded[player].reserve(static_cast<int>(Inputs::QUIT) + 1);
+            recorded[player].assign(inputs[player].begin(), inputs[player].end());
+        }
+        recordState(cm);
+    }
+
+    /**
+     * @brief Rewind the world to a recorded tick, and drop the ticks after it
+     *
+     * @return bool - Whether the tick was still held
+     */
+    bool rewind(ComponentManager &cm, uint64_t tick)
+    {
+        TRACE_SCOPE("Rollback::rewind");
+        if (tick < m_begin || tick >= m_end)
+            return false;
+
+        for (auto i = m_end - 1; i > tick; --i)
+        {
+            patch(m_state, getTick(i - 1).delta, m_scratch);
+            std::swap(m_state, m_scratch);
+        }
+        m_end = tick + 1;
+
+        return Snapshot::restore(cm, m_state, &m_stateSections);
+    }
+
+    /**
+     * @brief Rewind to a recorded tick and simulate forward to the newest one again, recording the new states
+     *
+     * @param correct - Called with each replayed tick and its inputs, which it may change
+     */
+    template <typename CorrectFn> bool resimulate(ComponentManager &cm, uint64_t tick, CorrectFn &&correct)
+    {
+        TRACE_SCOPE("Rollback::resimulate");
+        auto newest = m_end - 1;
+        if (!rewind(cm, tick))
+            return false;
+
+        for (auto i = tick; i < newest; ++i)
+        {
+            auto &replayed = getTick(i);
+            correct(i, replayed.inputs);
+            Utilities::registerPlayerInputs(cm, replayed.inputs);
+            Update::run(cm, true);
+            Utilities::setDeltaTime(cm, getTick(i + 1).deltaTime);
+            recordState(cm);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Get the newest recorded tick
+     */
+    uint64_t getNewest() const
+    {
+        return m_end - 1;
+    }
+
+    std::size_t getSize() const
+    {
+        return m_end - m_begin;
+    }
+
+    std::size_t getStateBytes() const
+    {
+        return m_state.size();
+    }
+
+    /**
+     * @brief Get the bytes held by the deltas of every recorded tick but the newest
+     */
+    std::size_t getDeltaBytes() const
+    {
+        std::size_t total{};
+        for (auto i = m_begin; i + 1 < m_end; ++i)
+            total += m_ticks[i % m_ticks.size()].delta.size();
+
+        return total;
+    }
+
+  private:
+    Tick &getTick(uint64_t tick)
+    {
+        return m_ticks[tick % m_ticks.size()];
+    }
+
+    void recordState(ComponentManager &cm)
+    {
+        TRACE_SCOPE("Rollback::record");
+        auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+        getTick(m_end).deltaTime = gameMetaComps.peek(&GameMetaComponent::deltaTime);
+
+        Snapshot::capture(cm, m_scratch, &m_scratchSections);
+        if (m_end > m_begin)
+            diff(m_scratch, m_scratchSections, m_state, m_stateSections, getTick(m_end - 1).delta);
+        std::swap(m_state, m_scratch);
+        std::swap(m_stateSections, m_scratchSections);
+
+        ++m_end;
+        m_begin = std::max(m_begin, m_end > m_ticks.size() ? m_end - m_ticks.size() : 0);
+    }
+
+    std::vector<Tick> m_ticks;
+    // Snapshot of the newest tick, and the buffer the next one is captured or patched into
+    std::vector<uint8_t> m_state{};
+    std::vector<uint8_t> m_scratch{};
+    Snapshot::Sections m_stateSections{};
+    Snapshot::Sections m_scratchSections{};
+    uint64_t m_begin{};
+    uint64_t m_end{};
+};
+
+/**
+ * @brief Timings of recording and resimulating over a run, to check rollback fits in a frame
+ */
+class Report
+{
+  public:
+    using Duration = std::chrono::duration<double, std::milli>;
+
+    void recordCapture(Duration duration)
+    {
+        m_capture += duration;
+        ++m_captures;
+    }
+
+    void recordResimulation(Duration duration, std::size_t deltaBytes, std::size_t deltas)
+    {
+        m_resimulation += duration;
+        m_worstResimulation = std::max(m_worstResimulation, duration);
+        m_deltaBytes += deltaBytes;
+        m_deltas += deltas;
+        ++m_resimulations;
+    }
+
+    void print(const History &history, int depth) const
+    {
+        if (!m_captures)
+            return;
+
+        PRINT("rollback: recorded", m_captures, "ticks, average", m_capture.count() / m_captures, "ms, state",
+              history.getStateBytes(), "bytes, average delta",
+              m_deltas ? m_deltaBytes / m_deltas : 0, "bytes")
+        if (m_resimulations)
+            PRINT("rollback: resimulated", depth, "ticks", m_resimulations, "times, average",
+                  m_resimulation.count() / m_resimulations, "ms, worst", m_worstResimulation.count(), "ms")
+    }
+
+  private:
+    Duration m_capture{};
+    Duration m_resimulation{};
+    Duration m_worstResimulation{};
+    uint64_t m_captures{};
+    uint64_t m_resimulations{};
+    std::size_t m_deltaBytes{};
+    std::size_t m_deltas{};
+};
+} // namespace Rollback
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "entities.hpp"
+#include "overlay.hpp"
+#include "recycler.hpp"
+#include "stages.hpp"
+#include "update.hpp"
+#include "utilities.hpp"
+#include "waves.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Benchmark scenarios which fill the arena stage with far more entities than any stage, through the
+ * same entity constructors the stages use. Each is run headless at growing entity counts, so the report shows
+ * how every system's cost grows with the count, not only what it costs on one stage.
+ */
+namespace Scenarios
+{
+using Builder = void (*)(ComponentManager &cm, int count);
+
+struct Scenario
+{
+    const char *name;
+    const char *description;
+    // Entities placed at full scale
+    int count;
+    // Entities placed when no scale is given, which is short of the full count where a run of it would take
+    // minutes. Collision tests every pair, with no broadphase, so the cost of a tick grows with the square of
+    // the count
+    int defaultCount;
+    Builder build;
+};
+
+/**
+ * @brief Call a constructor for each of the first count cells of a grid laid over the area, with cells as
+ * close to the aspect, their height over their width, as the area allows
+ */
+template <typename Place> inline void placeGrid(int count, Bounds area, Place &&place, float aspect = 1)
+{
+    auto [x, y, w, h] = area.get();
+    int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(count * aspect * w / h))));
+    int rows = (count + columns - 1) / columns;
+    float cellW = w / columns;
+    float cellH = h / std::max(1, rows);
+    for (int i = 0; i < count; ++i)
+        place(x + (i % columns) * cellW, y + (i / columns) * cellH, cellW, cellH, i / columns, rows);
+}
+
+inline Vector2 getScreen(ComponentManager &cm)
+{
+    auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    return gameMetaComps.peek(&GameMetaComponent::screen);
+}
+
+inline float getTileSize(ComponentManager &cm)
+{
+    auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    return gameMetaComps.peek(&GameMetaComponent::tileSize);
+}
+
+// One hive with every alien, small ones on top and large ones at the bottom
+inline void buildHive(ComponentManager &cm, int count)
+{
+    auto screen = getScreen(cm);
+    auto tileSize = getTileSize(cm);
+    hive(cm, 0, 0, tileSize, tileSize);
+    placeGrid(count, Bounds{tileSize, tileSize, screen.x - tileSize * 2, screen.y / 2},
+              [&](float x, float y, float w, float h, int row, int rows) {
+                  Waves::getAlienConstructor(row, 0, rows)(cm, x, y, w * 0.8f, h * 0.8f);
+              });
+}
+
+// The first player's shots fill the screen above the players, slowed down so most are still on screen by the
+// end. Only shots of different players pass through each other, so these shots would destroy each other on
+// touching. Each is placed in a cell shaped like the shot and half as large again, and the count is capped at
+// as many cells as fit, so the curtain stays whole and only costs movement and collision checks
+inline void buildCurtain(ComponentManager &cm, int count)
+{
+    // Shots made from 2 by 2 bounds are a fifth as wide and twice as tall, and all move together
+    constexpr float SHOT_W = 2.0f / 5;
+    constexpr float SHOT_H = 4;
+    constexpr float SPACING = 1.5f;
+    auto screen = getScreen(cm);
+    auto tileSize = getTileSize(cm);
+    auto playerId = Utilities::getPlayerId(cm, 0);
+    Bounds area{0, tileSize, screen.x, screen.y - tileSize * 4};
+    int cells = static_cast<int>(area.size.x * area.size.y / (SHOT_W * SHOT_H * SPACING * SPACING));
+    placeGrid(
+        std::min(count, cells), area,
+        [&](float x, float y, float, float, int, int) {
+            createUpwardProjectile(cm, playerId, Bounds{x, y, 2, 2});
+        },
+        SHOT_H / SHOT_W);
+}
+
+// A field of shields across the middle of the screen, rained on by the shots of a row of aliens above it
+inline void buildShields(ComponentManager &cm, int count)
+{
+    auto screen = getScreen(cm);
+    auto tileSize = getTileSize(cm);
+    hive(cm, 0, 0, tileSize, tileSize);
+    EntityId shooterId{};
+    for (float x = tileSize * 2; x < screen.x - tileSize * 2; x += tileSize * 2)
+        shooterId = hiveAlienSmall(cm, x, tileSize, tileSize, tileSize);
+
+    placeGrid(count, Bounds{tileSize, screen.y / 2, screen.x - tileSize * 2, screen.y / 4},
+              [&](float x, float y, float w, float h, int, int) { greenBlock(cm, x, y, w, h); });
+    placeGrid(count / 8, Bounds{tileSize, tileSize * 3, screen.x - tileSize * 2, screen.y / 2 - tileSize * 4},
+              [&](float x, float y, float, float, int, int) {
+                  createDownwardProjectile(cm, shooterId, Bounds{x, y, 4, 4});
+              });
+}
+
+// UFOs flying in formation across the top of the screen, each attacking on its own timer
+inline void buildUfos(ComponentManager &cm, int count)
+{
+    auto screen = getScreen(cm);
+    auto tileSize = getTileSize(cm);
+    placeGrid(count, Bounds{tileSize * 2, tileSize / 2, screen.x - tileSize * 2, screen.y / 3},
+              [&](float x, float y, float, float, int, int) { createUfo(cm, x, y); });
+}
+
+// Full counts are run with a scenario scale of 1. Measured at 3 ticks a step, a field of 20000 shields took
+// 2.3 s a tick, and a curtain of 10000 shots took 30 s a tick, so the curtain's 50000 would take over 12
+// minutes a tick. The curtain and the shields run at a fraction of their full counts by default for that.
+inline const std::array<Scenario, 4> catalogue{
+    Scenario{"hive", "one hive of aliens", 10000, 10000, buildHive},
+    Scenario{"curtain", "a curtain of player shots", 50000, 1000, buildCurtain},
+    Scenario{"shields", "a field of shields under a rain of alien shots", 20000, 5000, buildShields},
+    Scenario{"ufos", "a formation of UFOs", 5000, 5000, buildUfos},
+};
+
+/**
+ * @brief Runs the scenarios picked by the run config, each at every step of its count, in a fresh world for a
+ * fixed number of ticks, and reports every system's milliseconds per tick at each count.
+ */
+class Bench
+{
+  public:
+    // Ticks run at each count, unless a frame count is given
+    static constexpr int DEFAULT_TICKS = 60;
+    // Shares of a scenario's full count it is run at
+    static constexpr std::array<float, 4> STEPS{0.125f, 0.25f, 0.5f, 1.0f};
+
+    Bench(const RunConfig &config) : m_config(config)
+    {
+    }
+
+    void run()
+    {
+        for (const auto &scenario : catalogue)
+        {
+            if (m_config.scenario != "all" && m_config.scenario != scenario.name)
+                continue;
+
+            Result result{&scenario};
+            float fullCount = m_config.scenarioScale ? scenario.count * m_config.scenarioScale
+                                                     : static_cast<float>(scenario.defaultCount);
+            for (auto share : STEPS)
+            {
+                int count = std::max(1, static_cast<int>(fullCount * share));
+                result.steps.push_back(runStep(scenario, count));
+            }
+            m_results.push_back(std::move(result));
+        }
+
+        if (m_results.empty())
+            PRINT("UNKNOWN SCENARIO:", m_config.scenario)
+    }
+
+    void printReport() const
+    {
+        for (const auto &result : m_results)
+        {
+            const auto &first = result.steps.front();
+            const auto &last = result.steps.back();
+            PRINT("scenario:", result.scenario->name, "-", result.scenario->description, ",", first.ticks,
+                  "ticks at each count")
+            std::string line{"  entities          "};
+            for (const auto &step : result.steps)
+                line.append(format("%10u", step.entities));
+            PRINT(line)
+
+            printRow("  total ms/tick     ", result, [](const Step &step) { return step.totalMs; });
+            for (std::size_t system = 0; system < first.systems.size(); ++system)
+            {
+                std::string_view name{first.systems[system].name};
+                name.remove_prefix(std::min(name.find("::") + 2, name.size()));
+                auto padding = std::string(name.size() < 18 ? 18 - name.size() : 1, ' ');
+                printRow("  " + std::string(name) + padding, result,
+                         [&](const Step &step) { return double(step.systems[system].ms); });
+            }
+
+            if (last.ticks < first.ticks)
+                PRINT("  the game ended after", last.ticks, "ticks at the full count")
+            if (!m_config.scenarioScale && result.scenario->defaultCount < result.scenario->count)
+                PRINT("  run up to its default count of", result.scenario->defaultCount, "of its full",
+                      result.scenario->count, ", as collision tests every pair, which makes ticks at",
+                      "the full count take seconds to minutes. A scenario scale of 1 runs the full count")
+        }
+    }
+
+  private:
+    struct Step
+    {
+        uint32_t entities{};
+        int ticks{};
+        double totalMs{};
+        std::vector<Overlay::SystemTiming> systems{};
+    };
+
+    struct Result
+    {
+        const Scenario *scenario;
+        std::vector<Step> steps{};
+    };
+
+    static std::string format(const char *spec, auto value)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), spec, value);
+        return buffer;
+    }
+
+    /**
+     * @brief Print a row of milliseconds per tick, followed by the power of the entity count it grows with
+     * from the first count to the last, where 1 is linear and 2 quadratic
+     */
+    template <typename GetMs> static void printRow(std::string line, const Result &result, GetMs &&getMs)
+    {
+        for (const auto &step : result.steps)
+            line.append(format("%10.3f", getMs(step) / std::max(1, step.ticks)));
+
+        const auto &first = result.steps.front();
+        const auto &last = result.steps.back();
+        double firstMs = getMs(first) / std::max(1, first.ticks);
+        double lastMs = getMs(last) / std::max(1, last.ticks);
+        double countRatio = double(last.entities) / std::max(1u, first.entities);
+        if (firstMs > 0 && lastMs > 0 && countRatio > 1)
+        {
+            auto power = std::log(lastMs / firstMs) / std::log(countRatio);
+            line.append("   grows n^").append(format("%.2f", power));
+        }
+        PRINT(line)
+    }
+
+    Step runStep(const Scenario &scenario, int count)
+    {
+        using Clock = std::chrono::steady_clock;
+        // Building and playing the scenario logs every entity created and destroyed
+        isPrintMuted = true;
+        Step step{};
+        ScreenConfig screenConfig{};
+        ComponentManager cm{};
+        Utilities::initializeGame(cm, screenConfig);
+        Utilities::setFusedCombat(cm, m_config.fusedCombat);
+        // The overlay is never drawn here, but times the systems while it is visible
+        Overlay::enable(cm, true);
+        Utilities::startAtStage(cm, Stages::ARENA_STAGE);
+        auto [_, gameComps] = cm.getUnique<GameComponent>();
+        gameComps.mutate([](GameComponent &gameComp) {
+            gameComp.difficultyModifier = Utilities::calculateDifficultyModifier(1);
+        });
+        Utilities::joinPlayers(cm, m_config.players);
+        scenario.build(cm, count);
+        step.entities = Recycler::getEntityCount(cm);
+
+        int ticks = m_config.frames ? m_config.frames : DEFAULT_TICKS;
+        float delta = m_config.simStep ? m_config.simStep : 1.0f / 60;
+        Utilities::PlayerInputs inputs(std::max(1, m_config.players));
+        auto [overlayId, overlayComps] = cm.getUnique<Overlay::OverlayComponent>();
+        auto &timings = overlayComps.peek(&Overlay::OverlayComponent::systemTimings);
+        bool isPlaying = true;
+        while (step.ticks < ticks && isPlaying)
+        {
+            Utilities::setDeltaTime(cm, delta);
+            inputs[0].clear();
+            Utilities::addAutopilotInputs(inputs[0], step.ticks);
+            Utilities::addBotInputs(inputs, step.ticks);
+            Utilities::registerPlayerInputs(cm, inputs);
+
+            auto start = Clock::now();
+            isPlaying = Update::run(cm);
+            step.totalMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            ++step.ticks;
+
+            if (step.systems.empty())
+                step.systems = timings;
+            else
+                for (std::size_t system = 0; system < timings.size(); ++system)
+                    step.systems[system].ms += timings[system].ms;
+        }
+        isPrintMuted = false;
+
+        return step;
+    }
+
+    RunConfig m_config;
+    std::vector<Result> m_results{};
+};
+} // namespace Scenarios
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "core.hpp"
+#include "net.hpp"
+#include "pacer.hpp"
+#include "session.hpp"
+#include "trace.hpp"
+#include "utilities.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Authoritative headless game session. Runs its updates at a fixed tick on its own thread, taking
+ * inputs from clients and sending them the render element changes of every tick.
+ */
+class Server
+{
+  public:
+    Server(const RunConfig &config) : m_config(config), m_session(config), m_inputs(config.players)
+    {
+    }
+
+    ~Server()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        m_isRunning = true;
+        m_thread = std::thread([this]() { loop(); });
+    }
+
+    void stop()
+    {
+        m_isRunning = false;
+        // A server waiting for room to send its update is woken, so it sees it has been stopped
+        m_updates.close();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    /**
+     * @brief Whether the game has ended, and no more updates will be sent
+     */
+    bool isFinished() const
+    {
+        return m_isFinished;
+    }
+
+    /**
+     * @brief Get the channel a player's inputs are sent on
+     */
+    Net::Channel &getInputs(std::size_t player)
+    {
+        return m_inputs[player];
+    }
+
+    Net::Channel &getUpdates()
+    {
+        return m_updates;
+    }
+
+    void printReport() const
+    {
+        if (!m_session.getTicks())
+            return;
+
+        double ticks = m_session.getTicks();
+        uint64_t inputBytes{};
+        for (const auto &channel : m_inputs)
+            inputBytes += channel.getBytes();
+        PRINT("server:", m_session.getTicks(), "ticks in", m_elapsed.count(), "s,", ticks / m_elapsed.count(),
+              "ticks/sec,", m_updates.getBytes() / ticks, "update bytes/tick,", inputBytes / ticks,
+              "input bytes/tick")
+    }
+
+  private:
+    void loop()
+    {
+        Trace::nameThread("server");
+        auto tickRate = m_config.tickRate;
+        FramePacer pacer{tickRate ? PacingMode::FIXED : PacingMode::UNCAPPED, tickRate};
+        Utilities::PlayerInputs inputs(m_inputs.size());
+        for (auto &playerInputs : inputs)
+            playerInputs.reserve(static_cast<int>(Inputs::QUIT) + 1);
+        std::vector<uint8_t> message{};
+
+        auto start = std::chrono::steady_clock::now();
+        while (m_isRunning)
+        {
+            TRACE_SCOPE("Server::tick");
+            pacer.beginFrame();
+
+            // Inputs from every client frame since the last tick are merged, so presses aren't dropped
+            for (std::size_t player = 0; player < m_inputs.size(); ++player)
+            {
+                uint32_t mask{};
+                while (m_inputs[player].receive(message))
+                    mask |= Net::decodeInputs(message);
+                Net::expandInputs(mask, inputs[player]);
+            }
+
+            // Sending waits while the client is behind, so an uncapped server is at most a channel ahead
+            bool isPlaying = m_session.tick(inputs, message);
+            if (!m_updates.send(message) || !isPlaying)
+                break;
+
+            pacer.wait();
+            float step = tickRate ? 1.0f / tickRate : pacer.getDeltaTime();
+            m_session.setDeltaTime(m_config.simStep ? m_config.simStep : step);
+        }
+        m_elapsed = std::chrono::steady_clock::now() - start;
+        // Clients can't be left waiting to send inputs nobody will receive
+        for (auto &channel : m_inputs)
+            channel.close();
+        m_isFinished = true;
+    }
+
+    RunConfig m_config;
+    Session m_session;
+    // One channel per player
+    std::vector<Net::Channel> m_inputs;
+    Net::Channel m_updates{};
+    std::thread m_thread{};
+    std::atomic<bool> m_isRunning{false};
+    std::atomic<bool> m_isFinished{false};
+    std::chrono::duration<double> m_elapsed{};
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "core.hpp"
+#include "net.hpp"
+#include "overlay.hpp"
+#include "snapshot.hpp"
+#include "update.hpp"
+#include "utilities.hpp"
+#include "waves.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief A headless game, owning its world and updated a tick at a time with the inputs it is given. Nothing
+ * is rendered; the render element changes of every tick are encoded as an update for clients instead.
+ */
+class Session
+{
+  public:
+    Session(const RunConfig &config)
+    {
+        Utilities::initializeGame(m_entityComponentManager, m_screenConfig);
+        Utilities::setFusedCombat(m_entityComponentManager, config.fusedCombat);
+        Overlay::enable(m_entityComponentManager, false);
+        if (config.endless)
+            Waves::enable(m_entityComponentManager, config);
+        if (config.startStage)
+            Utilities::startAtStage(m_entityComponentManager, config.startStage);
+        Utilities::joinPlayers(m_entityComponentManager, config.players);
+        if (config.loadSnapshot)
+        {
+            if (Snapshot::load(m_entityComponentManager, config.snapshotFile))
+                PRINT("SERVER LOADED SNAPSHOT FROM", config.snapshotFile)
+            else
+                PRINT("FAILED TO LOAD SNAPSHOT", config.snapshotFile)
+        }
+    }
+
+    /**
+     * @brief Run a tick's update with each player's inputs, and encode the render element changes it made
+     *
+     * @return bool - Whether the game is still playing
+     */
+    bool tick(const Utilities::PlayerInputs &inputs, std::vector<uint8_t> &update)
+    {
+        Utilities::registerPlayerInputs(m_entityComponentManager, inputs);
+        bool isPlaying = Update::run(m_entityComponentManager);
+        Net::encodeUpdate(m_entityComponentManager, ++m_ticks, update);
+        m_updateBytes += update.size();
+
+        return isPlaying;
+    }
+
+    /**
+     * @brief Set the step the next tick's update is run with
+     */
+    void setDeltaTime(float step)
+    {
+        Utilities::setDeltaTime(m_entityComponentManager, step);
+    }
+
+    uint64_t getTicks() const
+    {
+        return m_ticks;
+    }
+
+    uint64_t getUpdateBytes() const
+    {
+        return m_updateBytes;
+    }
+
+  private:
+    ScreenConfig m_screenConfig{};
+    ComponentManager m_entityComponentManager{};
+    uint64_t m_ticks{};
+    uint64_t m_updateBytes{};
+};
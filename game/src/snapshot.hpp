@@ -0,0 +1,560 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "overlay.hpp"
+#include "render_list.hpp"
+#include "timers.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Binary snapshots of the whole world, for checkpointing into a stage and restoring from it. Every
+ * component type in components.hpp is stored per entity, except the transformation caches, which are
+ * invalidated instead, and telemetry, which samples on through a restore. The overlay's elements are stored
+ * too, so its UI entities stay known to it.
+ *
+ * Entities keep their ids, so references between entities stay valid, and the recycler's count of ids handed
+ * out is restored with them, so a restored world goes on to hand out the same ids as after the capture.
+ * Restoring clears every stored type before adding the saved components back, which leaves entities created
+ * after the capture without components. Effect timers are stored against the saved sim clock, which is
+ * restored along with them, so their remaining time is exact.
+ */
+namespace Snapshot
+{
+constexpr std::array<char, 4> MAGIC{'B', 'I', 'S', 'N'};
+constexpr uint32_t VERSION = 8;
+
+template <typename... Ts> struct TypeList
+{
+};
+
+// Offsets where each stored type starts, after the header's at 0. Lets deltas compare snapshots type by type
+using Sections = std::vector<uint32_t>;
+
+// clang-format off
+// Append new types to the end, and bump the version when the list or a component's layout changes
+using Components = TypeList<
+    PlayerEvent, PlayerComponent, ScoreComponent, LivesComponent, PlayerScoreCardComponent,
+    PlayerLifeCardComponent, TelemetryCardComponent, ScoreEvent, AIComponent, HiveComponent,
+    UFOAIComponent, HiveAIComponent, PlayerInputEvent, AIInputEvent, AIMovementEffect, HiveMovementEffect,
+    MovementEffect, MovementComponent, MovementEvent, CollidableComponent, PositionComponent, PositionEvent,
+    HealthEvent, HealthComponent, CollisionCheckEvent, DamageEvent, DeathEvent, DeathComponent,
+    ContactBufferComponent, DeactivatedComponent, DamageComponent, AttackComponent, AttackEvent,
+    AttackEffect, AITimeoutEffect, UFOTimeoutEffect, UFOAttackTimeoutEffect, StartGameTriggerComponent,
+    TitleScreenComponent, GameComponent, GameMetaComponent, EffectExpiryComponent, TagMaskComponent,
+    GameEvent, SpriteComponent, UIComponent, RenderListComponent, UIEvent, TextComponent,
+    ObstacleComponent, ProjectileComponent, PointsComponent, PowerupEvent, PowerupComponent, PowerupEffect,
+    PowerupTimeoutEffect, HiveRosterComponent, WaveComponent, EntityRecyclerComponent,
+    Overlay::OverlayElementsComponent>;
+
+// Every effect type added through Timers::add, which queued expiries are stored as an index into
+using TimedEffects = TypeList<
+    AttackEffect, AITimeoutEffect, UFOTimeoutEffect, UFOAttackTimeoutEffect, PowerupEffect,
+    PowerupTimeoutEffect>;
+// clang-format on
+
+template <typename... Ts> constexpr uint32_t countTypes(TypeList<Ts...>)
+{
+    return sizeof...(Ts);
+}
+
+template <typename... Ts> constexpr auto getExpireFuncs(TypeList<Ts...>)
+{
+    return std::array<decltype(EffectExpiryComponent::Expiry::expire), sizeof...(Ts)>{
+        &Timers::expireEffect<Ts>...};
+}
+
+class Writer
+{
+  public:
+    Writer(std::vector<uint8_t> &bytes) : m_bytes(bytes)
+    {
+    }
+
+    template <typename T> void value(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto *data = reinterpret_cast<const uint8_t *>(&value);
+        m_bytes.insert(m_bytes.end(), data, data + sizeof(T));
+    }
+
+    void string(const std::string &string)
+    {
+        value(static_cast<uint32_t>(string.size()));
+        m_bytes.insert(m_bytes.end(), string.begin(), string.end());
+    }
+
+    template <typename T> void vector(const std::vector<T> &values)
+    {
+        value(static_cast<uint32_t>(values.size()));
+        for (const auto &element : values)
+            value(element);
+    }
+
+    uint32_t getSize() const
+    {
+        return static_cast<uint32_t>(m_bytes.size());
+    }
+
+  private:
+    std::vector<uint8_t> &m_bytes;
+};
+
+/**
+ * @brief Bounds checked reader. Reading past the end yields zeroed values and marks the reader as failed
+ */
+class Reader
+{
+  public:
+    Reader(const std::vector<uint8_t> &bytes)
+        : m_begin(bytes.data()), m_pos(bytes.data()), m_end(bytes.data() + bytes.size())
+    {
+    }
+
+    template <typename T> T value()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::array<std::byte, sizeof(T)> raw{};
+        if (take(sizeof(T)))
+            std::memcpy(raw.data(), m_pos - sizeof(T), sizeof(T));
+
+        return std::bit_cast<T>(raw);
+    }
+
+    std::string string()
+    {
+        auto size = value<uint32_t>();
+        if (!take(size))
+            return {};
+
+        return std::string(reinterpret_cast<const char *>(m_pos - size), size);
+    }
+
+    template <typename T> std::vector<T> vector()
+    {
+        auto size = value<uint32_t>();
+        if (size > remaining() / sizeof(T))
+        {
+            m_isFailed = true;
+            return {};
+        }
+
+        std::vector<T> values{};
+        values.reserve(size);
+        for (uint32_t i = 0; i < size; ++i)
+            values.push_back(value<T>());
+
+        return values;
+    }
+
+    bool isOk() const
+    {
+        return !m_isFailed;
+    }
+
+    bool isDone() const
+    {
+        return m_pos == m_end;
+    }
+
+    uint32_t getOffset() const
+    {
+        return static_cast<uint32_t>(m_pos - m_begin);
+    }
+
+  private:
+    std::size_t remaining() const
+    {
+        return m_end - m_pos;
+    }
+
+    bool take(std::size_t size)
+    {
+        if (m_isFailed || size > remaining())
+        {
+            m_isFailed = true;
+            return false;
+        }
+
+        m_pos += size;
+        return true;
+    }
+
+    const uint8_t *m_begin;
+    const uint8_t *m_pos;
+    const uint8_t *m_end;
+    bool m_isFailed{false};
+};
+
+/**
+ * @brief Stores plain components byte for byte. Components which own memory or hold process specific state
+ * specialize this.
+ */
+template <typename T> struct Codec
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Components owning memory need a Codec specialization");
+
+    static void write(Writer &writer, const T &component)
+    {
+        writer.value(component);
+    }
+
+    static T read(Reader &reader)
+    {
+        return reader.value<T>();
+    }
+};
+
+template <> struct Codec<TextComponent>
+{
+    static void write(Writer &writer, const TextComponent &component)
+    {
+        writer.string(component.text);
+        writer.value(component.color);
+    }
+
+    static TextComponent read(Reader &reader)
+    {
+        auto text = reader.string();
+        return TextComponent{std::move(text), reader.value<Renderer::RGBA>()};
+    }
+};
+
+template <> struct Codec<EntityRecyclerComponent>
+{
+    static void write(Writer &writer, const EntityRecyclerComponent &component)
+    {
+        writer.vector(component.freeIds);
+        writer.vector(component.releasedIds);
+        writer.value(component.highestId);
+        writer.value(component.entityCount);
+        writer.value(component.isReusing);
+    }
+
+    // The library's counter isn't restored, and is caught up with again by the next entity created
+    static EntityRecyclerComponent read(Reader &reader)
+    {
+        EntityRecyclerComponent component{};
+        component.freeIds = reader.vector<EntityId>();
+        component.releasedIds = reader.vector<EntityId>();
+        component.highestId = reader.value<EntityId>();
+        component.entityCount = reader.value<uint32_t>();
+        component.isReusing = reader.value<bool>();
+
+        return component;
+    }
+};
+
+template <> struct Codec<Overlay::OverlayElementsComponent>
+{
+    static void write(Writer &writer, const Overlay::OverlayElementsComponent &component)
+    {
+        writer.vector(component.lineIds);
+        writer.vector(component.barIds);
+    }
+
+    static Overlay::OverlayElementsComponent read(Reader &reader)
+    {
+        Overlay::OverlayElementsComponent component{};
+        component.lineIds = reader.vector<EntityId>();
+        component.barIds = reader.vector<EntityId>();
+
+        return component;
+    }
+};
+
+// Masks are indexed by entity id, so only the entities with tags are stored
+template <> struct Codec<TagMaskComponent>
+{
+    struct StoredMask
+    {
+        EntityId id;
+        uint32_t mask;
+    };
+
+    static void write(Writer &writer, const TagMaskComponent &component)
+    {
+        uint32_t count = std::count_if(component.masks.begin(), component.masks.end(),
+                                       [](uint32_t mask) { return mask != 0; });
+        writer.value(count);
+        for (std::size_t id = 0; id < component.masks.size(); ++id)
+            if (component.masks[id])
+                writer.value(StoredMask{static_cast<EntityId>(id), component.masks[id]});
+    }
+
+    static TagMaskComponent read(Reader &reader)
+    {
+        TagMaskComponent component{};
+        for (const auto &stored : reader.vector<StoredMask>())
+        {
+            if (stored.id >= component.masks.size())
+                component.masks.resize(stored.id + 1);
+            component.masks[stored.id] = stored.mask;
+        }
+
+        return component;
+    }
+};
+
+// Expiries are stored with the index of their effect type instead of a function pointer
+template <> struct Codec<EffectExpiryComponent>
+{
+    struct StoredExpiry
+    {
+        double time;
+        EntityId id;
+        uint32_t typeIndex;
+    };
+
+    static void write(Writer &writer, const EffectExpiryComponent &component)
+    {
+        static constexpr auto expireFuncs = getExpireFuncs(TimedEffects{});
+        writer.value(static_cast<uint32_t>(component.queue.size()));
+        for (const auto &expiry : component.queue)
+        {
+            auto typeIndex = std::distance(expireFuncs.begin(),
+                                           std::find(expireFuncs.begin(), expireFuncs.end(), expiry.expire));
+            writer.value(StoredExpiry{expiry.time, expiry.id, static_cast<uint32_t>(typeIndex)});
+        }
+    }
+
+    static EffectExpiryComponent read(Reader &reader)
+    {
+        static constexpr auto expireFuncs = getExpireFuncs(TimedEffects{});
+        EffectExpiryComponent component{};
+        for (const auto &stored : reader.vector<StoredExpiry>())
+        {
+            if (stored.typeIndex < expireFuncs.size())
+                component.queue.push_back({stored.time, stored.id, expireFuncs[stored.typeIndex]});
+        }
+
+        return component;
+    }
+};
+
+// The render list is rebuilt after restoring, and the contact buffer and hive roster only hold the current
+// frame's contacts and aliens
+template <> struct Codec<RenderListComponent>
+{
+    static void write(Writer &, const RenderListComponent &)
+    {
+    }
+
+    static RenderListComponent read(Reader &)
+    {
+        return RenderListComponent{};
+    }
+};
+
+template <> struct Codec<ContactBufferComponent>
+{
+    static void write(Writer &, const ContactBufferComponent &)
+    {
+    }
+
+    static ContactBufferComponent read(Reader &)
+    {
+        return ContactBufferComponent{};
+    }
+};
+
+template <> struct Codec<HiveRosterComponent>
+{
+    static void write(Writer &, const HiveRosterComponent &)
+    {
+    }
+
+    static HiveRosterComponent read(Reader &)
+    {
+        return HiveRosterComponent{};
+    }
+};
+
+/**
+ * @brief Write every entity's components of one type as: entity count, then per entity its id, instance
+ * count and instances
+ */
+template <typename T> inline void writeType(ComponentManager &cm, Writer &writer, EntityId &maxId)
+{
+    auto &ids = cm.getEntityIds<T>();
+    writer.value(static_cast<uint32_t>(ids.size()));
+    for (const auto &id : ids)
+    {
+        maxId = std::max(maxId, id);
+        auto [comps] = cm.get<T>(id);
+        uint32_t count{};
+        comps.inspect([&](const T &) { ++count; });
+        writer.value(id);
+        writer.value(count);
+
+        // Transformed components are read through mutate, which exposes the stored value rather than the
+        // transformed one
+        if constexpr (std::is_base_of_v<Transform, T>)
+            comps.mutate([&](T &component) { Codec<T>::write(writer, component); });
+        else
+            comps.inspect([&](const T &component) { Codec<T>::write(writer, component); });
+    }
+}
+
+/**
+ * @brief Read one type's components, adding them to the world only when applying
+ */
+template <typename T, bool isApplied> inline void readType(ComponentManager &cm, Reader &reader)
+{
+    if constexpr (isApplied)
+        cm.clear<T>();
+
+    auto entityCount = reader.value<uint32_t>();
+    for (uint32_t i = 0; i < entityCount && reader.isOk(); ++i)
+    {
+        auto id = reader.value<EntityId>();
+        auto count = reader.value<uint32_t>();
+        for (uint32_t j = 0; j < count && reader.isOk(); ++j)
+        {
+            T component = Codec<T>::read(reader);
+            if (isApplied && reader.isOk())
+                cm.add<T>(id, std::move(component));
+        }
+    }
+}
+
+template <typename... Ts>
+inline void writeTypes(ComponentManager &cm, Writer &writer, EntityId &maxId, Sections *sections,
+                       TypeList<Ts...>)
+{
+    auto writeSection = [&]<typename T>() {
+        if (sections)
+            sections->push_back(writer.getSize());
+        writeType<T>(cm, writer, maxId);
+    };
+    (writeSection.template operator()<Ts>(), ...);
+}
+
+template <bool isApplied, typename... Ts>
+inline void readTypes(ComponentManager &cm, Reader &reader, Sections *sections, TypeList<Ts...>)
+{
+    auto readSection = [&]<typename T>() {
+        if (sections)
+            sections->push_back(reader.getOffset());
+        readType<T, isApplied>(cm, reader);
+    };
+    (readSection.template operator()<Ts>(), ...);
+}
+
+/**
+ * @brief Capture the world into the bytes, reusing their storage
+ *
+ * @param sections - Optionally filled with where each type starts
+ */
+inline void capture(ComponentManager &cm, std::vector<uint8_t> &bytes, Sections *sections = nullptr)
+{
+    bytes.clear();
+    if (sections)
+    {
+        sections->clear();
+        sections->push_back(0);
+    }
+
+    Writer writer{bytes};
+    writer.value(MAGIC);
+    writer.value(VERSION);
+    writer.value(countTypes(Components{}));
+
+    // The highest entity id precedes the components, and is filled in once they are written
+    auto maxIdOffset = bytes.size();
+    EntityId maxId{};
+    writer.value(maxId);
+    writeTypes(cm, writer, maxId, sections, Components{});
+    std::memcpy(bytes.data() + maxIdOffset, &maxId, sizeof(maxId));
+}
+
+/**
+ * @brief Read a snapshot, applying it to the world only when isApplied is set
+ *
+ * @param maxId - Set to the highest entity id in the snapshot
+ * @param sections - Optionally filled with where each type starts
+ */
+template <bool isApplied>
+inline bool read(ComponentManager &cm, const std::vector<uint8_t> &bytes, EntityId &maxId,
+                 Sections *sections = nullptr)
+{
+    Reader reader{bytes};
+    if (sections)
+    {
+        sections->clear();
+        sections->push_back(0);
+    }
+
+    if (reader.value<decltype(MAGIC)>() != MAGIC || reader.value<uint32_t>() != VERSION ||
+        reader.value<uint32_t>() != countTypes(Components{}))
+        return false;
+
+    maxId = reader.value<EntityId>();
+
+    readTypes<isApplied>(cm, reader, sections, Components{});
+
+    return reader.isOk() && reader.isDone();
+}
+
+/**
+ * @brief Restore the world from captured bytes. Bytes from capture are trusted, so they aren't validated
+ * before the world is changed
+ *
+ * @param sections - Optionally filled with where each type starts
+ *
+ * @return bool - Whether the bytes were a complete snapshot
+ */
+inline bool restore(ComponentManager &cm, const std::vector<uint8_t> &bytes, Sections *sections = nullptr)
+{
+    EntityId maxId{};
+    bool isRestored = read<true>(cm, bytes, maxId, sections);
+    Utilities::invalidateTransformations(cm);
+    RenderList::markStale(cm);
+
+    return isRestored;
+}
+
+inline bool save(ComponentManager &cm, const std::string &path)
+{
+    std::vector<uint8_t> bytes{};
+    capture(cm, bytes);
+
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+
+    return !!file;
+}
+
+/**
+ * @brief Restore the world from a snapshot file. The file is validated in full first, so a bad file leaves
+ * the world untouched
+ */
+inline bool load(ComponentManager &cm, const std::string &path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+        return false;
+
+    std::vector<uint8_t> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    EntityId maxId{};
+    if (!read<false>(cm, bytes, maxId))
+        return false;
+
+    // A freshly started world's library hasn't handed out the restored entities' ids yet
+    while (cm.createEntity() < maxId)
+        ;
+
+    return restore(cm, bytes);
+}
+} // namespace Snapshot
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "core.hpp"
+#include "renderer.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Renderer
+{
+/**
+ * @brief CPU rasterizer which draws renderable elements into an RGBA framebuffer, for running without a
+ * display server. Rects are filled one span at a time, with vectorized stores and blending where available.
+ * Text is not rasterized, as there is no font rendering without SDL.
+ */
+class SoftwareRasterizer
+{
+  public:
+    SoftwareRasterizer(int width, int height) : m_width(width), m_height(height), m_pixels(width * height)
+    {
+    }
+
+    void clear(const RGBA &rgba = RGBA{0, 0, 0, 255})
+    {
+        std::fill(m_pixels.begin(), m_pixels.end(), pack(rgba));
+    }
+
+    /**
+     * @brief Render the elements passed in. UI elements are last to ensure they are overlaid on top
+     */
+    void render(const std::vector<RenderableElement> &worldElements,
+                const std::vector<RenderableElement> &uiElements)
+    {
+        for (const auto &element : worldElements)
+            renderTile(element);
+
+        for (const auto &element : uiElements)
+            renderTile(element);
+    }
+
+    const std::vector<uint32_t> &pixels() const
+    {
+        return m_pixels;
+    }
+
+    bool writePPM(const std::string &path) const
+    {
+        std::ofstream file{path, std::ios::binary};
+        if (!file)
+            return false;
+
+        file << "P6\n" << m_width << " " << m_height << "\n255\n";
+        std::vector<uint8_t> row(m_width * 3);
+        for (int y = 0; y < m_height; ++y)
+        {
+            for (int x = 0; x < m_width; ++x)
+            {
+                auto pixel = unpack(m_pixels[y * m_width + x]);
+                row[x * 3] = pixel.r;
+                row[x * 3 + 1] = pixel.g;
+                row[x * 3 + 2] = pixel.b;
+            }
+            file.write(reinterpret_cast<const char *>(row.data()), row.size());
+        }
+
+        return !!file;
+    }
+
+    /**
+     * @brief Write an uncompressed PNG. The output is byte for byte reproducible, so frames can be diffed
+     * directly against golden images.
+     */
+    bool writePNG(const std::string &path) const
+    {
+        std::ofstream file{path, std::ios::binary};
+        if (!file)
+            return false;
+
+        // Each scanline is prefixed with filter type 0 (none)
+        std::vector<uint8_t> raw{};
+        raw.reserve((m_width * 4 + 1) * m_height);
+        for (int y = 0; y < m_height; ++y)
+        {
+            raw.push_back(0);
+            for (int x = 0; x < m_width; ++x)
+            {
+                auto pixel = unpack(m_pixels[y * m_width + x]);
+                raw.insert(raw.end(), {pixel.r, pixel.g, pixel.b, pixel.a});
+            }
+        }
+
+        std::vector<uint8_t> header{};
+        appendBigEndian(header, m_width);
+        appendBigEndian(header, m_height);
+        // 8 bit depth, RGBA color type, default compression, filter and interlace methods
+        header.insert(header.end(), {8, 6, 0, 0, 0});
+
+        const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+        writeChunk(file, "IHDR", header);
+        writeChunk(file, "IDAT", storeDeflate(raw));
+        writeChunk(file, "IEND", {});
+
+        return !!file;
+    }
+
+  private:
+    static uint32_t pack(const RGBA &rgba)
+    {
+        uint32_t packed;
+        uint8_t bytes[4] = {rgba.r, rgba.g, rgba.b, rgba.a};
+        std::memcpy(&packed, bytes, sizeof(packed));
+        return packed;
+    }
+
+    static RGBA unpack(uint32_t packed)
+    {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &packed, sizeof(packed));
+        return RGBA{bytes[0], bytes[1], bytes[2], bytes[3]};
+    }
+
+    void renderTile(const RenderableElement &re)
+    {
+        // Text tiles are drawn with an invisible color
+        if (!re.text.empty() || !re.rgba.a)
+            return;
+
+        // Truncate the same way as the conversion to SDL_Rect
+        int x0 = std::max(static_cast<int>(re.x), 0);
+        int y0 = std::max(static_cast<int>(re.y), 0);
+        int x1 = std::min(static_cast<int>(re.x) + static_cast<int>(re.w), m_width);
+        int y1 = std::min(static_cast<int>(re.y) + static_cast<int>(re.h), m_height);
+        if (x0 >= x1 || y0 >= y1)
+            return;
+
+        for (int y = y0; y < y1; ++y)
+        {
+            uint32_t *span = &m_pixels[y * m_width + x0];
+            if (re.rgba.a == 255)
+                fillSpan(span, x1 - x0, pack(re.rgba));
+            else
+                blendSpan(span, x1 - x0, re.rgba);
+        }
+    }
+
+    static void fillSpan(uint32_t *span, int count, uint32_t color)
+    {
+        int i{0};
+#if defined(__SSE2__)
+        __m128i colors = _mm_set1_epi32(static_cast<int>(color));
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(span + i), colors);
+#endif
+        for (; i < count; ++i)
+            span[i] = color;
+    }
+
+    // dst = (src * a + dst * (255 - a)) / 255, per channel, with the alpha channel blended the same way
+    static void blendSpan(uint32_t *span, int count, const RGBA &rgba)
+    {
+        int i{0};
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alpha = _mm_set1_epi16(rgba.a);
+        const __m128i inverse = _mm_set1_epi16(255 - rgba.a);
+        const __m128i one = _mm_set1_epi16(1);
+        __m128i source = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(pack(rgba))), zero);
+        source = _mm_mullo_epi16(source, alpha);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(span + i));
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), inverse), source);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), inverse), source);
+            // Exact division by 255: (x + 1 + (x >> 8)) >> 8
+            lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(span + i), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            auto dst = unpack(span[i]);
+            auto blend = [&](uint8_t s, uint8_t d) -> uint8_t {
+                uint32_t x = s * rgba.a + d * (255 - rgba.a);
+                return (x + 1 + (x >> 8)) >> 8;
+            };
+            span[i] = pack(RGBA{blend(rgba.r, dst.r), blend(rgba.g, dst.g), blend(rgba.b, dst.b),
+                                blend(rgba.a, dst.a)});
+        }
+    }
+
+    static void appendBigEndian(std::vector<uint8_t> &bytes, uint32_t value)
+    {
+        bytes.insert(bytes.end(), {static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                                   static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)});
+    }
+
+    static uint32_t crc32(const uint8_t *data, std::size_t size, uint32_t crc = 0)
+    {
+        static const auto table = []() {
+            std::array<uint32_t, 256> table{};
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            return table;
+        }();
+
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+        return ~crc;
+    }
+
+    // Wrap the data in a zlib stream made of uncompressed deflate blocks
+    static std::vector<uint8_t> storeDeflate(const std::vector<uint8_t> &data)
+    {
+        constexpr std::size_t MAX_BLOCK = 65535;
+        std::vector<uint8_t> out{0x78, 0x01};
+        std::size_t offset{0};
+        do
+        {
+            std::size_t size = std::min(MAX_BLOCK, data.size() - offset);
+            bool isLast = offset + size == data.size();
+            out.push_back(isLast ? 1 : 0);
+            out.insert(out.end(), {static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+                                   static_cast<uint8_t>(~size), static_cast<uint8_t>(~size >> 8)});
+            out.insert(out.end(), data.begin() + offset, data.begin() + offset + size);
+            offset += size;
+        } while (offset < data.size());
+
+        uint32_t a{1}, b{0};
+        for (const auto &byte : data)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBigEndian(out, (b << 16) | a);
+
+        return out;
+    }
+
+    static void writeChunk(std::ofstream &file, const char *type, const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> chunk{};
+        appendBigEndian(chunk, data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        appendBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+    }
+
+    int m_width;
+    int m_height;
+    std::vector<uint32_t> m_pixels;
+};
+} // namespace Renderer
@@ -2,11 +2,34 @@
 
 #include "core.hpp"
 #include "entities.hpp"
+#include <string_view>
+#include <vector>
 
 // clang-format off
 namespace Stages
 {
-inline std::function<EntityId(ComponentManager &cm, float, float, float, float)> getEntityConstructor(char c)
+// The last of the fixed stages. Endless runs generate every stage after it, see Waves
+constexpr int LAST_STAGE = 5;
+// Empty stage the benchmark scenarios are built on
+constexpr int ARENA_STAGE = 200;
+
+/**
+ * @brief A stage compiled to the entities it places, by tile column and row
+ */
+struct Layout
+{
+    struct Placement
+    {
+        EntityConstructor construct;
+        int col;
+        int row;
+    };
+
+    std::vector<Placement> placements{};
+    std::size_t columns{};
+};
+
+inline EntityConstructor getEntityConstructor(char c)
 {
     switch (c)
     {
@@ -32,10 +55,10 @@ inline std::function<EntityId(ComponentManager &cm, float, float, float, float)>
         return titleBlock;
     }
 
-    return NULL;
+    return nullptr;
 };
 
-const std::vector<std::string_view> titlePage{
+inline const std::vector<std::string_view> titlePage{
     "                               ",
     "                               ",
     "   &&&  &     &&   &&& &  &    ", 
@@ -60,7 +83,7 @@ const std::vector<std::string_view> titlePage{
     "               P               ",
 };
 
-const std::vector<std::string_view> stage1{
+inline const std::vector<std::string_view> stage1{
     "  H                           ",
     "                              ",
     "     S S S S S S S S S S S    ", 
@@ -85,7 +108,7 @@ const std::vector<std::string_view> stage1{
     "                              ",
 };
 
-const std::vector<std::string_view> stage2{
+inline const std::vector<std::string_view> stage2{
     " H                            ",
     "                              ",
     "                              ",
@@ -110,7 +133,7 @@ const std::vector<std::string_view> stage2{
     "                              ",
 };
 
-const std::vector<std::string_view> stage3{
+inline const std::vector<std::string_view> stage3{
     " H                            ",
     "                              ",
     "                              ",
@@ -135,7 +158,7 @@ const std::vector<std::string_view> stage3{
     "                              ",
 };
 
-const std::vector<std::string_view> stage4{
+inline const std::vector<std::string_view> stage4{
     " H                            ",
     "                              ",
     "                              ",
@@ -160,7 +183,7 @@ const std::vector<std::string_view> stage4{
     "                              ",
 };
 
-const std::vector<std::string_view> stage5{
+inline const std::vector<std::string_view> stage5{
     " H                            ",
     "                              ",
     "                              ",
@@ -185,7 +208,7 @@ const std::vector<std::string_view> stage5{
     "                              ",
 };
 
-const std::vector<std::string_view> stage6{
+inline const std::vector<std::string_view> stage6{
     " H                            ",
     "                              ",
     "                              ",
@@ -210,7 +233,7 @@ const std::vector<std::string_view> stage6{
     "                              ",
 };
 
-const std::vector<std::string_view> stage7{
+inline const std::vector<std::string_view> stage7{
     " H                            ",
     "                              ",
     "                              ",
@@ -235,7 +258,7 @@ const std::vector<std::string_view> stage7{
     "                              ",
 };
 
-const std::vector<std::string_view> stage8{
+inline const std::vector<std::string_view> stage8{
     " H                             ",
     "                               ",
     "                               ",
@@ -260,7 +283,37 @@ const std::vector<std::string_view> stage8{
     "                               ",
 };
 
-const std::vector<std::string_view> gameOver{
+inline const std::vector<std::string_view> hiveSwarm{
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    " H S S S  H M M M  H L L L    ", 
+    "                              ",
+    "  ####    ####   ####   ####  ", 
+    "  #  #    #  #   #  #   #  #  ",
+    "                              ",
+    "                              ", 
+    "                              ",
+};
+
+// Empty stage which the benchmark scenarios place their own entities on, see Scenarios
+inline const std::vector<std::string_view> arena{
+    "                              ",
+};
+
+inline const std::vector<std::string_view> gameOver{
     "                              ",
     "                              ",
     "    @@@@@ @@@@@ @   @ @@@@    ",
@@ -285,7 +338,7 @@ const std::vector<std::string_view> gameOver{
     "                              ",
 };
 
-inline std::vector<std::string_view> getStage(int stage)
+inline const std::vector<std::string_view> &getStage(int stage)
 {
    switch(stage) 
    {
@@ -299,6 +352,11 @@ inline std::vector<std::string_view> getStage(int stage)
         return stage4;
     case 5:
         return stage5;
+    // Stress stages, only started with --stage
+    case 100:
+        return hiveSwarm;
+    case ARENA_STAGE:
+        return arena;
     case 999:
         return titlePage;
     default:
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Per tick hashes of the simulation state which decides how a replay plays out: positions, health,
+ * score, lives, effect timers, the stage and the sim clock and random state. Each entity's state is hashed
+ * separately and the world hash combines them, so when two runs of the same replay diverge, the first
+ * divergent tick and the entities which differ can be named.
+ *
+ * Hashes are written to a log as each tick's world hash followed by the entity hashes which changed, and a
+ * later run can be compared against that log as it plays.
+ */
+namespace StateHash
+{
+constexpr std::array<char, 4> MAGIC{'B', 'I', 'S', 'H'};
+constexpr uint32_t VERSION = 1;
+// How many divergent entities are listed at the first divergent tick
+constexpr std::size_t REPORTED_ENTITIES = 8;
+
+inline uint64_t mix(uint64_t hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+inline uint64_t mix(uint64_t hash, float value)
+{
+    return mix(hash, static_cast<uint64_t>(std::bit_cast<uint32_t>(value)));
+}
+
+inline uint64_t mix(uint64_t hash, double value)
+{
+    return mix(hash, std::bit_cast<uint64_t>(value));
+}
+
+inline uint64_t mix(uint64_t hash, int32_t value)
+{
+    return mix(hash, static_cast<uint64_t>(static_cast<uint32_t>(value)));
+}
+
+// Written to the log as is, so its padding is explicit
+struct EntityHash
+{
+    EntityId id;
+    uint32_t padding;
+    uint64_t hash;
+};
+
+/**
+ * @brief Hashes of every hashed entity, indexed by id, with 0 for entities holding no hashed state
+ */
+class Hashes
+{
+  public:
+    void clear()
+    {
+        for (const auto &id : m_ids)
+            m_hashes[id] = 0;
+        m_ids.clear();
+    }
+
+    template <typename... Values> void add(EntityId id, Values... values)
+    {
+        if (id >= m_hashes.size())
+            m_hashes.resize(id + 1);
+
+        auto &hash = m_hashes[id];
+        if (!hash)
+        {
+            m_ids.push_back(id);
+            hash = mix(0xCBF29CE484222325ull, static_cast<uint64_t>(id));
+        }
+        ((hash = mix(hash, values)), ...);
+    }
+
+    uint64_t get(EntityId id) const
+    {
+        return id < m_hashes.size() ? m_hashes[id] : 0;
+    }
+
+    /**
+     * @brief Combine the entity hashes, independently of the order entities were hashed in
+     */
+    uint64_t combine() const
+    {
+        uint64_t total{};
+        for (const auto &id : m_ids)
+            total += m_hashes[id];
+
+        return total;
+    }
+
+    const std::vector<EntityId> &getIds() const
+    {
+        return m_ids;
+    }
+
+    std::size_t getIdLimit() const
+    {
+        return m_hashes.size();
+    }
+
+  private:
+    std::vector<uint64_t> m_hashes{};
+    // Every id hashed since the last clear
+    std::vector<EntityId> m_ids{};
+};
+
+/**
+ * @brief Hash every entity's state for this tick
+ */
+inline void hash(ComponentManager &cm, Hashes &hashes)
+{
+    auto [positionSet] = cm.getAll<PositionComponent>();
+    positionSet.each([&](EId eId, auto &positionComps) {
+        auto [x, y, w, h] = positionComps.peek(&PositionComponent::bounds).get();
+        hashes.add(eId, x, y, w, h);
+    });
+
+    auto [healthSet] = cm.getAll<HealthComponent>();
+    healthSet.each([&](EId eId, auto &healthComps) {
+        healthComps.inspect([&](const HealthComponent &healthComp) {
+            hashes.add(eId, healthComp.total, healthComp.current);
+        });
+    });
+
+    auto [scoreSet] = cm.getAll<ScoreComponent>();
+    scoreSet.each([&](EId eId, auto &scoreComps) {
+        hashes.add(eId, static_cast<int32_t>(scoreComps.peek(&ScoreComponent::score)));
+    });
+
+    auto [livesSet] = cm.getAll<LivesComponent>();
+    livesSet.each([&](EId eId, auto &livesComps) {
+        hashes.add(eId, static_cast<int32_t>(livesComps.peek(&LivesComponent::count)));
+    });
+
+    // Timed effects are hashed by when they expire, on the entity they belong to
+    auto [_, expiryComps] = cm.getUnique<EffectExpiryComponent>();
+    expiryComps.inspect([&](const EffectExpiryComponent &expiryComp) {
+        for (const auto &expiry : expiryComp.queue)
+            hashes.add(expiry.id, expiry.time);
+    });
+
+    auto [gameId, gameComps] = cm.getUnique<GameComponent>();
+    hashes.add(gameId, static_cast<int32_t>(gameComps.peek(&GameComponent::currentStage)));
+
+    auto [gameMetaId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    gameMetaComps.inspect([&](const GameMetaComponent &gameMetaComp) {
+        hashes.add(gameMetaId, gameMetaComp.simTime, gameMetaComp.randomState);
+    });
+}
+
+/**
+ * @brief Hashes every tick, and optionally logs the hashes or compares them against a log
+ */
+class Recorder
+{
+  public:
+    bool openLog(const std::string &path)
+    {
+        m_log.open(path, std::ios::binary);
+        m_log.write(MAGIC.data(), MAGIC.size());
+        m_log.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+
+        return !!m_log;
+    }
+
+    bool openReference(const std::string &path)
+    {
+        m_reference.open(path, std::ios::binary);
+        std::array<char, 4> magic{};
+        uint32_t version{};
+        m_reference.read(magic.data(), magic.size());
+        m_reference.read(reinterpret_cast<char *>(&version), sizeof(version));
+        m_isComparing = m_reference && magic == MAGIC && version == VERSION;
+
+        return m_isComparing;
+    }
+
+    /**
+     * @brief Hash the state at the end of a tick, then log and compare it
+     */
+    void record(ComponentManager &cm, uint64_t tick)
+    {
+        TRACE_SCOPE("StateHash::record");
+        auto start = std::chrono::steady_clock::now();
+        std::swap(m_current, m_previous);
+        m_current.clear();
+        hash(cm, m_current);
+        m_worldHash = m_current.combine();
+        m_lastTick = tick;
+        ++m_ticks;
+        m_hashTime += std::chrono::steady_clock::now() - start;
+
+        if (m_log.is_open())
+            writeTick(tick);
+        if (m_isComparing)
+            compareTick(tick);
+    }
+
+    void printReport() const
+    {
+        if (!m_ticks)
+            return;
+
+        PRINT("state hash:", m_worldHash, "at tick", m_lastTick, "hashing took on average",
+              m_hashTime.count() / m_ticks, "us per tick")
+        if (m_isDiverged)
+            return;
+
+        if (m_comparedTicks)
+            PRINT("STATE MATCHED THE REFERENCE FOR", m_comparedTicks, "TICKS")
+    }
+
+  private:
+    /**
+     * @brief Write the tick, its world hash and the entities whose hash changed, with 0 for those removed
+     */
+    void writeTick(uint64_t tick)
+    {
+        m_changes.clear();
+        for (const auto &id : m_current.getIds())
+            if (m_current.get(id) != m_previous.get(id))
+                m_changes.push_back(EntityHash{id, 0, m_current.get(id)});
+        for (const auto &id : m_previous.getIds())
+            if (m_previous.get(id) && !m_current.get(id))
+                m_changes.push_back(EntityHash{id, 0, 0});
+
+        auto count = static_cast<uint32_t>(m_changes.size());
+        m_log.write(reinterpret_cast<const char *>(&tick), sizeof(tick));
+        m_log.write(reinterpret_cast<const char *>(&m_worldHash), sizeof(m_worldHash));
+        m_log.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        m_log.write(reinterpret_cast<const char *>(m_changes.data()), count * sizeof(EntityHash));
+    }
+
+    /**
+     * @brief Read the reference's next tick, and report the entities which differ at the first divergence
+     */
+    void compareTick(uint64_t tick)
+    {
+        uint64_t referenceTick{}, referenceHash{};
+        uint32_t count{};
+        m_reference.read(reinterpret_cast<char *>(&referenceTick), sizeof(referenceTick));
+        m_reference.read(reinterpret_cast<char *>(&referenceHash), sizeof(referenceHash));
+        m_reference.read(reinterpret_cast<char *>(&count), sizeof(count));
+        m_changes.resize(count);
+        m_reference.read(reinterpret_cast<char *>(m_changes.data()), count * sizeof(EntityHash));
+        if (!m_reference || referenceTick != tick)
+        {
+            PRINT("STATE REFERENCE ENDED BEFORE TICK", tick)
+            m_isComparing = false;
+            return;
+        }
+
+        for (const auto &change : m_changes)
+        {
+            if (change.id >= m_referenceHashes.size())
+                m_referenceHashes.resize(change.id + 1);
+            m_referenceHashes[change.id] = change.hash;
+        }
+        ++m_comparedTicks;
+        if (referenceHash == m_worldHash)
+            return;
+
+        PRINT("STATE DIVERGED FROM THE REFERENCE AT TICK", tick, "world hash", m_worldHash, "expected",
+              referenceHash)
+        std::size_t reported{};
+        auto idLimit = std::max(m_current.getIdLimit(), m_referenceHashes.size());
+        for (EntityId id = 0; id < idLimit; ++id)
+        {
+            auto hash = m_current.get(id);
+            auto expected = id < m_referenceHashes.size() ? m_referenceHashes[id] : 0;
+            if (hash != expected && reported++ < REPORTED_ENTITIES)
+                PRINT("  entity", id, "hash", hash, "expected", expected)
+        }
+        if (reported > REPORTED_ENTITIES)
+            PRINT("  and", reported - REPORTED_ENTITIES, "more entities")
+
+        m_isComparing = false;
+        m_isDiverged = true;
+    }
+
+    Hashes m_current{};
+    Hashes m_previous{};
+    // The reference's entity hashes as of its current tick, indexed by id
+    std::vector<uint64_t> m_referenceHashes{};
+    std::vector<EntityHash> m_changes{};
+    std::ofstream m_log{};
+    std::ifstream m_reference{};
+    std::chrono::duration<double, std::micro> m_hashTime{};
+    uint64_t m_worldHash{};
+    uint64_t m_lastTick{};
+    uint64_t m_ticks{};
+    uint64_t m_comparedTicks{};
+    bool m_isComparing{false};
+    bool m_isDiverged{false};
+};
+} // namespace StateHash
@@ -3,72 +3,147 @@
 #include "../components.hpp"
 #include "../core.hpp"
 #include "../entities.hpp"
+#include "../random.hpp"
+#include "../recycler.hpp"
+#include "../resources.hpp"
 #include "../utilities.hpp"
 #include "ecs/ecs.hpp"
+#include <algorithm>
+#include <span>
 
 namespace Systems::AI
 {
 inline void cleanup(ComponentManager &cm)
 {
-    Utilities::cleanupEffect<AITimeoutEffect, UFOTimeoutEffect, UFOAttackTimeoutEffect>(cm);
 }
 
-// Adds components to left and right aliens to denote their position
-inline void updateOutsideHiveAliens(ComponentManager &cm, EId hiveId, const HiveComponent &hiveComp)
+/**
+ * @brief Changes the hive AI decides on while it reads the roster, which add and remove components and
+ * entities, so they are applied once it is done with the roster. Kept on the thread and reused every frame so
+ * it doesn't allocate once grown
+ */
+struct HiveChanges
 {
-    auto &ids = cm.getEntityIds<HiveAIComponent>();
-    if (ids.empty())
+    struct Move
     {
-        cm.add<GameEvent>(hiveId, GameEvents::NEXT_STAGE);
-        return;
-    }
+        EntityId alienId;
+        Vector2 speed;
+    };
 
-    // Add components to distinquish the aliens on the left and right sites of the hive
-    auto [x, y, w, h] = hiveComp.bounds.box();
-    for (const auto &eId : ids)
+    struct Attack
     {
-        auto [positionComps] = cm.get<PositionComponent>(eId);
-        auto [aiX, aiY, aiW, aiH] = positionComps.peek(&PositionComponent::bounds).box();
-        if (aiX <= x)
-            cm.add<LeftAlienComponent>(eId);
-        if (aiW >= w)
-            cm.add<RightAlienComponent>(eId);
+        EntityId hiveId;
+        EntityId attackerId;
+        float delay;
     };
+
+    // The hive found without aliens once no hive has any left, which clears the stage
+    EntityId clearingHiveId{};
+    // Hives whose aliens are all killed
+    std::vector<EntityId> disbandedIds{};
+    std::vector<Move> moves{};
+    // Hives whose attack timeout has elapsed
+    std::vector<EntityId> elapsedTimeoutIds{};
+    std::vector<Attack> attacks{};
+
+    void clear()
+    {
+        clearingHiveId = 0;
+        disbandedIds.clear();
+        moves.clear();
+        elapsedTimeoutIds.clear();
+        attacks.clear();
+    }
+};
+
+inline HiveChanges &getHiveChanges()
+{
+    thread_local HiveChanges changes{};
+    return changes;
 }
 
-// Sets the boundaries of the hive based on the outmost alien positions
-inline void updateHiveBounds(ComponentManager &cm, EId hiveId)
+// Groups the aliens by the hive they belong to, keeping each hive's aliens in the order they are stored
+inline void gatherHiveAliens(ComponentManager &cm, HiveRosterComponent &roster)
 {
-    auto [hiveComps] = cm.get<HiveComponent>(hiveId);
-    hiveComps.mutate([&](HiveComponent &hiveComp) {
-        constexpr float MIN_FLOAT = std::numeric_limits<float>::min();
-        constexpr float MAX_FLOAT = std::numeric_limits<float>::max();
-
-        Vector2 topLeft{MAX_FLOAT, MAX_FLOAT};
-        Vector2 bottomRight{MIN_FLOAT, MIN_FLOAT};
-
-        // Get the topleft and bottomright hive bounds from the alien positions
-        cm.getGroup<HiveAIComponent, PositionComponent>().each([&](EId eId, auto &_, auto &positionComps) {
-            positionComps.inspect([&](const PositionComponent &posComp) {
-                auto [x, y, w, h] = posComp.bounds.box();
-                if (x < topLeft.x)
-                    topLeft.x = x;
-                if (y < topLeft.y)
-                    topLeft.y = y;
-                if (w > bottomRight.x)
-                    bottomRight.x = w;
-                if (h > bottomRight.y)
-                    bottomRight.y = h;
-            });
-        });
+    roster.hives.clear();
+    for (const auto &hiveId : cm.getEntityIds<HiveComponent>())
+    {
+        if (hiveId >= roster.hiveIndices.size())
+            roster.hiveIndices.resize(hiveId + 1);
+        roster.hiveIndices[hiveId] = roster.hives.size();
+        roster.hives.push_back(HiveRosterComponent::Hive{hiveId, 0, 0});
+    }
+
+    auto getHive = [&](auto &hiveAiComps) -> HiveRosterComponent::Hive * {
+        auto hiveId = hiveAiComps.peek(&HiveAIComponent::hiveId);
+        if (hiveId >= roster.hiveIndices.size())
+            return nullptr;
+
+        auto &hive = roster.hives[roster.hiveIndices[hiveId]];
+        return hive.id == hiveId ? &hive : nullptr;
+    };
 
-        hiveComp.bounds = Bounds{topLeft, Vector2{bottomRight.x - topLeft.x, bottomRight.y - topLeft.y}};
-        updateOutsideHiveAliens(cm, hiveId, hiveComp);
+    // Count each hive's aliens, then place them into their hive's range
+    auto [hiveAiSet] = cm.getAll<HiveAIComponent>();
+    hiveAiSet.each([&](EId, auto &hiveAiComps) {
+        if (auto *hive = getHive(hiveAiComps))
+            ++hive->end;
     });
+
+    uint32_t total{};
+    for (auto &hive : roster.hives)
+    {
+        hive.begin = total;
+        total += hive.end;
+        hive.end = hive.begin;
+    }
+
+    roster.alienIds.resize(total);
+    hiveAiSet.each([&](EId eId, auto &hiveAiComps) {
+        if (auto *hive = getHive(hiveAiComps))
+            roster.alienIds[hive->end++] = eId;
+    });
+}
+
+// Sets the boundaries of the hive and its left and right aliens, based on the outmost alien positions
+inline void updateHiveBounds(ComponentManager &cm, HiveComponent &hiveComp, std::span<const EntityId> aliens)
+{
+    constexpr float MIN_FLOAT = std::numeric_limits<float>::min();
+    constexpr float MAX_FLOAT = std::numeric_limits<float>::max();
+
+    Vector2 topLeft{MAX_FLOAT, MAX_FLOAT};
+    Vector2 bottomRight{MIN_FLOAT, MIN_FLOAT};
+
+    // Get the topleft and bottomright hive bounds from the alien positions
+    for (const auto &eId : aliens)
+    {
+        auto [positionComps] = cm.get<PositionComponent>(eId);
+        auto [x, y, w, h] = positionComps.peek(&PositionComponent::bounds).box();
+        topLeft.x = std::min(topLeft.x, x);
+        topLeft.y = std::min(topLeft.y, y);
+        bottomRight.x = std::max(bottomRight.x, w);
+        bottomRight.y = std::max(bottomRight.y, h);
+    }
+
+    hiveComp.bounds = Bounds{topLeft, Vector2{bottomRight.x - topLeft.x, bottomRight.y - topLeft.y}};
+    hiveComp.leftAlienId = 0;
+    hiveComp.rightAlienId = 0;
+
+    // The first aliens found on the left and right sides of the hive stand for them
+    auto [x, y, w, h] = hiveComp.bounds.box();
+    for (const auto &eId : aliens)
+    {
+        auto [positionComps] = cm.get<PositionComponent>(eId);
+        auto [aiX, aiY, aiW, aiH] = positionComps.peek(&PositionComponent::bounds).box();
+        if (aiX <= x && !hiveComp.leftAlienId)
+            hiveComp.leftAlienId = eId;
+        if (aiW >= w && !hiveComp.rightAlienId)
+            hiveComp.rightAlienId = eId;
+    }
 }
 
 // Transitions the hive movement into the next direction
-inline void handleHiveShift(ComponentManager &cm, auto &hiveMovementEffects)
+inline void handleHiveShift(auto &hiveMovementEffects)
 {
     hiveMovementEffects.mutate([&](HiveMovementEffect &hiveMovementEffect) {
         using Movement = decltype(HiveMovementEffect::movement);
@@ -88,23 +163,12 @@ inline void handleHiveShift(ComponentManager &cm, auto &hiveMovementEffects)
     });
 }
 
-inline float getDifficultyModifier(ComponentManager &cm)
-{
-    auto [_, gameComps] = cm.getUnique<GameComponent>();
-    float modifier = gameComps.peek(&GameComponent::currentStage) / 2.0f;
-    if (modifier < 1)
-        modifier = 1;
-
-    return modifier;
-}
-
 // Calculates movement speed based on the input speed, movement configuration object, and current stage speed
 // modifier
 template <typename Movement>
-inline Vector2 calculateSpeed(ComponentManager &cm, const Vector2 &speed, const Movement &movement)
+inline Vector2 calculateSpeed(Resources &res, const Vector2 &speed, const Movement &movement)
 {
-    auto [_, gameComps] = cm.getUnique<GameComponent>();
-    float modifier = getDifficultyModifier(cm);
+    float modifier = res.getDifficultyModifier();
 
     Vector2 calculatedSpeed{0, 0};
 
@@ -130,20 +194,20 @@ inline Vector2 calculateSpeed(ComponentManager &cm, const Vector2 &speed, const
 }
 
 template <typename Movement>
-inline bool checkHiveAgainstScreenBoundaries(ComponentManager &cm, EId hiveId, Movement &movement)
+inline bool checkHiveAgainstScreenBoundaries(ComponentManager &cm, Resources &res, EId hiveId,
+                                             const HiveComponent &hiveComp, Movement &movement)
 {
-    auto [gameId, gameComps] = cm.getUnique<GameComponent>();
     auto [movementComps] = cm.get<MovementComponent>(hiveId);
     auto &hiveSpeeds = movementComps.peek(&MovementComponent::speeds);
 
-    auto &hiveAiIds = movement == Movement::LEFT ? cm.getEntityIds<LeftAlienComponent>()
-                                                 : cm.getEntityIds<RightAlienComponent>();
-    if (!hiveAiIds.size())
+    auto edgeAlienId = movement == Movement::LEFT ? hiveComp.leftAlienId : hiveComp.rightAlienId;
+    auto [posComps] = cm.get<PositionComponent>(edgeAlienId);
+    if (!posComps)
         return false;
 
-    auto [posComps] = cm.get<PositionComponent>(hiveAiIds[0]);
+    auto [x, y] = calculateSpeed(res, hiveSpeeds, movement);
+    auto [gX, gY, gW, gH] = res.game.peek(&GameComponent::bounds).box();
     return !!(posComps.find([&](const PositionComponent &positionComp) {
-        auto [x, y] = calculateSpeed(cm, hiveSpeeds, movement);
         Bounds newBounds{
             positionComp.bounds.position.x + x,
             positionComp.bounds.position.y + y,
@@ -151,7 +215,6 @@ inline bool checkHiveAgainstScreenBoundaries(ComponentManager &cm, EId hiveId, M
             positionComp.bounds.size.y + y,
         };
 
-        auto [gX, gY, gW, gH] = gameComps.peek(&GameComponent::bounds).box();
         auto [nX, nY, nW, nH] = newBounds.box();
 
         return nX <= gX || nY <= gY || nW >= gW || nH >= gH;
@@ -159,141 +222,176 @@ inline bool checkHiveAgainstScreenBoundaries(ComponentManager &cm, EId hiveId, M
 }
 
 // Check the leftmost and rightmost alien positions to see if the hive is out of bounds
-inline bool checkIsHiveOutOfBounds(ComponentManager &cm, EId hiveId, auto &hiveMovementEffects)
+inline bool checkIsHiveOutOfBounds(ComponentManager &cm, Resources &res, EId hiveId,
+                                   std::span<const EntityId> aliens, auto &hiveMovementEffects)
 {
-    if (!cm.exists<LeftAlienComponent>() || !cm.exists<RightAlienComponent>())
-        updateHiveBounds(cm, hiveId);
+    auto [hiveComps] = cm.get<HiveComponent>(hiveId);
+    auto &tagMasks = res.getTagMasks();
+    auto isAlive = [&](EntityId id) { return id && TagMask::hasAny<HiveAIComponent>(tagMasks, id); };
+    if (!isAlive(hiveComps.peek(&HiveComponent::leftAlienId)) ||
+        !isAlive(hiveComps.peek(&HiveComponent::rightAlienId)))
+        hiveComps.mutate([&](HiveComponent &hiveComp) { updateHiveBounds(cm, hiveComp, aliens); });
 
     auto movement = hiveMovementEffects.peek(&HiveMovementEffect::movement);
     using Movement = decltype(movement);
 
+    bool isOutOfBounds{false};
     switch (movement)
     {
     case Movement::LEFT:
     case Movement::RIGHT:
-        return checkHiveAgainstScreenBoundaries(cm, hiveId, movement);
+        hiveComps.inspect([&](const HiveComponent &hiveComp) {
+            isOutOfBounds = checkHiveAgainstScreenBoundaries(cm, res, hiveId, hiveComp, movement);
+        });
+        break;
     default:
         break;
     }
 
-    return false;
+    return isOutOfBounds;
 }
 
-// Moves each hive alien based on the hive movement effect
-inline void moveHiveAI(ComponentManager &cm, EId hiveId, auto &hiveMovementEffects)
+// Moves each of the hive's aliens based on the hive movement effect
+inline void moveHiveAI(ComponentManager &cm, Resources &res, EId hiveId, std::span<const EntityId> aliens,
+                       auto &hiveMovementEffects, HiveChanges &changes)
 {
     auto movement = hiveMovementEffects.peek(&HiveMovementEffect::movement);
     auto [movementComps] = cm.get<MovementComponent>(hiveId);
     auto &speeds = movementComps.peek(&MovementComponent::speeds);
 
-    auto &allHiveAiIds = cm.getEntityIds<HiveAIComponent>();
-    if (!allHiveAiIds.size())
-        return;
-
-    auto newSpeed = calculateSpeed(cm, speeds, movement);
+    auto newSpeed = calculateSpeed(res, speeds, movement);
     if (!newSpeed.x && !newSpeed.y)
         return;
 
-    for (const auto &eId : cm.getEntityIds<HiveAIComponent>())
-        cm.add<MovementEvent>(eId, std::move(newSpeed));
+    for (const auto &eId : aliens)
+        changes.moves.push_back(HiveChanges::Move{eId, newSpeed});
 }
 
-// Updates the hive movement data
-inline void updateHiveMovement(ComponentManager &cm, EId hiveId, auto &hiveMovementEffects)
+// Updates the hive movement data, moving faster as the hive's aliens are killed
+inline void updateHiveMovement(ComponentManager &cm, Resources &res, EId hiveId, std::size_t hiveAICount,
+                               auto &hiveMovementEffects)
 {
+    auto [hiveComps] = cm.get<HiveComponent>(hiveId);
+    float hiveTotal = hiveComps.peek(&HiveComponent::alienTotal);
     hiveMovementEffects.mutate([&](HiveMovementEffect &hiveMovementEffect) {
-        auto &allHiveAiIds = cm.getEntityIds<HiveAIComponent>();
-        auto hiveAICount = allHiveAiIds.size();
-        if (!hiveAICount)
-            return;
-
         using Movement = decltype(HiveMovementEffect::movement);
         if (hiveMovementEffect.movement == Movement::DOWN)
             hiveMovementEffect.movement = hiveMovementEffect.nextMove;
 
-        float hiveTotal = 55.0f;
         float diff = hiveTotal - hiveAICount;
         diff = diff > 0 ? diff : 1.0f;
         float interval = 0.5f / (diff / 2);
 
-        hiveMovementEffect.timer->update(interval);
+        hiveMovementEffect.simTimer.update(interval, res.getSimTime());
     });
 }
 
-inline bool checkShouldHiveAIMove(ECS::Components<HiveMovementEffect> &hiveMovementEffects)
+inline bool checkShouldHiveAIMove(ECS::Components<HiveMovementEffect> &hiveMovementEffects, double now)
 {
     return !!(hiveMovementEffects.find([&](const HiveMovementEffect &hiveMovementEffect) {
-        return hiveMovementEffect.timer->hasElapsed();
+        return hiveMovementEffect.simTimer.hasElapsed(now);
     }));
 }
 
-// Handles moving hive aliens and updating the hive movement data
-inline void updateHive(ComponentManager &cm)
+// Handles moving each hive's aliens and updating its movement data. A hive whose aliens are all killed is
+// disbanded, and the stage is cleared once no hive has aliens left
+inline void updateHive(ComponentManager &cm, Resources &res, const HiveRosterComponent &roster,
+                       HiveChanges &changes)
 {
-    auto [hiveMovementSet] = cm.getAll<HiveMovementEffect>();
-    hiveMovementSet.each([&](EId hiveId, auto &hiveMovementEffects) {
-        if (checkIsHiveOutOfBounds(cm, hiveId, hiveMovementEffects))
-            handleHiveShift(cm, hiveMovementEffects);
+    double now = res.getSimTime();
+    for (const auto &hive : roster.hives)
+    {
+        auto aliens = roster.getAliens(hive);
+        if (aliens.empty())
+        {
+            if (roster.alienIds.empty())
+            {
+                changes.clearingHiveId = hive.id;
+                return;
+            }
+
+            changes.disbandedIds.push_back(hive.id);
+            continue;
+        }
 
-        if (checkShouldHiveAIMove(hiveMovementEffects))
+        auto [hiveMovementEffects] = cm.get<HiveMovementEffect>(hive.id);
+        if (!hiveMovementEffects)
+            continue;
+
+        if (checkIsHiveOutOfBounds(cm, res, hive.id, aliens, hiveMovementEffects))
+            handleHiveShift(hiveMovementEffects);
+
+        if (checkShouldHiveAIMove(hiveMovementEffects, now))
         {
-            moveHiveAI(cm, hiveId, hiveMovementEffects);
-            updateHiveMovement(cm, hiveId, hiveMovementEffects);
+            moveHiveAI(cm, res, hive.id, aliens, hiveMovementEffects, changes);
+            updateHiveMovement(cm, res, hive.id, aliens.size(), hiveMovementEffects);
         }
-    });
+    }
 }
 
-// Choose a random alien to attack. The alien cannot already be attacking, and there
-// are limits to how freqently the hive can attack, and how many aliens can be attacking
+// Choose a random alien of each hive to attack. The alien cannot already be attacking, and there
+// are limits to how freqently a hive can attack, and how many of its aliens can be attacking
 // at the same time.  All of that is handled here.
-inline void handleHiveAttack(ComponentManager &cm)
+inline void handleHiveAttack(ComponentManager &cm, Resources &res, const HiveRosterComponent &roster,
+                             HiveChanges &changes)
 {
-    auto [hiveId, hiveComps] = cm.getUnique<HiveComponent>();
-    if (!hiveId)
-        return;
-
-    auto [aiTimeoutEffects] = cm.get<AITimeoutEffect>(hiveId);
-    if (aiTimeoutEffects)
+    double now = res.getSimTime();
+    for (const auto &hive : roster.hives)
     {
-        auto elapsedEffect = aiTimeoutEffects.find(
-            [&](const AITimeoutEffect &AITimeoutEffect) { return AITimeoutEffect.timer->hasElapsed(); });
+        auto [aiTimeoutEffects] = cm.get<AITimeoutEffect>(hive.id);
+        if (aiTimeoutEffects)
+        {
+            auto elapsedEffect = aiTimeoutEffects.find([&](const AITimeoutEffect &AITimeoutEffect) {
+                return AITimeoutEffect.simTimer.hasElapsed(now);
+            });
 
-        if (!elapsedEffect)
-            return;
+            if (!elapsedEffect)
+                continue;
 
-        cm.remove<AITimeoutEffect>(hiveId);
-    }
+            changes.elapsedTimeoutIds.push_back(hive.id);
+        }
 
-    auto &attackingAIs = cm.getEntityIds<HiveAIComponent, AttackEffect>();
-    if (attackingAIs.size() >= 3)
-        return;
+        // Pick a random AI which isn't already attacking, counting the candidates in place instead of
+        // copying them out
+        auto aliens = roster.getAliens(hive);
+        auto isIdle = [&](EntityId id) { return !cm.contains<AttackEffect>(id); };
+        auto candidates = std::count_if(aliens.begin(), aliens.end(), isIdle);
+        if (aliens.size() - candidates >= 3 || !candidates)
+            continue;
+
+        auto randomIndex = Random::next(cm) % candidates;
+        auto attackerId = *std::find_if(aliens.begin(), aliens.end(),
+                                        [&](EntityId id) { return isIdle(id) && !randomIndex--; });
+        float randomDelay = Random::next(cm) % 10;
+        changes.attacks.push_back(HiveChanges::Attack{hive.id, attackerId, randomDelay});
+    }
+}
 
-    auto hiveAiIds = cm.getEntityIds<HiveAIComponent>();
-    if (hiveAiIds.empty())
-        return;
+inline void applyHiveMovement(ComponentManager &cm, const HiveChanges &changes)
+{
+    for (const auto &move : changes.moves)
+        cm.add<MovementEvent>(move.alienId, move.speed);
+    Recycler::destroy(cm, changes.disbandedIds);
+    if (changes.clearingHiveId)
+        cm.add<GameEvent>(changes.clearingHiveId, GameEvents::NEXT_STAGE);
+}
 
-    for (auto iter = hiveAiIds.begin(); iter != hiveAiIds.end();)
+inline void applyHiveAttacks(ComponentManager &cm, Resources &res, const HiveChanges &changes)
+{
+    double now = res.getSimTime();
+    for (const auto &hiveId : changes.elapsedTimeoutIds)
+        cm.remove<AITimeoutEffect>(hiveId);
+    for (const auto &attack : changes.attacks)
     {
-        auto id = hiveAiIds[*iter];
-
-        if (Utilities::containsId(attackingAIs, id))
-            iter = hiveAiIds.erase(iter);
-        else
-            ++iter;
+        cm.add<AttackEvent>(attack.attackerId, 0);
+        Timers::add<AITimeoutEffect>(cm, attack.hiveId, attack.delay, now);
     }
-
-    float randomIndex = std::rand() % hiveAiIds.size();
-    cm.add<AttackEvent>(hiveAiIds[randomIndex], 0);
-
-    float randomDelay = std::rand() % 10;
-    cm.add<AITimeoutEffect>(hiveId, randomDelay);
 }
 
 // Creates a new UFO if allowed
-inline void updateUFO(ComponentManager &cm)
+inline void updateUFO(ComponentManager &cm, Resources &res)
 {
-    auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
-    auto [ufoTimeoutEffect] = cm.get<UFOTimeoutEffect>(gameId);
+    auto [ufoTimeoutEffect] = cm.get<UFOTimeoutEffect>(res.gameId);
     if (ufoTimeoutEffect)
         return;
 
@@ -301,37 +399,49 @@ inline void updateUFO(ComponentManager &cm)
     if (ufoAISet)
         return;
 
-    const float &tileSize = gameMetaComps.peek(&GameMetaComponent::tileSize);
+    const float &tileSize = res.gameMeta.peek(&GameMetaComponent::tileSize);
     createUfo(cm, 10.0f, tileSize / 2);
-    cm.add<UFOTimeoutEffect>(gameId, 15);
+    Timers::add<UFOTimeoutEffect>(cm, res.gameId, 15, res.getSimTime());
 }
 
 // Creates a UFO attack if the UFO is not in a timeout state
-inline void handleUFOAttack(ComponentManager &cm)
+inline void handleUFOAttack(ComponentManager &cm, Resources &res)
 {
+    double now = res.getSimTime();
+    float modifier = res.getDifficultyModifier();
     auto [ufoAISet] = cm.getAll<UFOAIComponent>();
     ufoAISet.each([&](EId eId, auto &ufoAiComps) {
         if (cm.contains<UFOAttackTimeoutEffect>(eId))
             return;
 
-        float modifier = getDifficultyModifier(cm);
         int maxInterval = 5000;
         // Get random number in milliseconds
-        float randInterval = std::rand() % maxInterval;
+        float randInterval = Random::next(cm) % maxInterval;
         // Convert to seconds
         randInterval = randInterval / 1000;
         cm.add<AttackEvent>(eId, 0);
-        cm.add<UFOAttackTimeoutEffect>(eId, randInterval / modifier);
+        Timers::add<UFOAttackTimeoutEffect>(cm, eId, randInterval / modifier, now);
     });
 }
 
-inline auto update(ComponentManager &cm)
+inline auto update(ComponentManager &cm, Resources &res)
 {
-    updateHive(cm);
-    updateUFO(cm);
-
-    handleHiveAttack(cm);
-    handleUFOAttack(cm);
+    auto &changes = getHiveChanges();
+    changes.clear();
+    auto [_, rosterComps] = cm.getUnique<HiveRosterComponent>();
+    rosterComps.mutate([&](HiveRosterComponent &roster) {
+        gatherHiveAliens(cm, roster);
+        updateHive(cm, res, roster, changes);
+    });
+    applyHiveMovement(cm, changes);
+    updateUFO(cm, res);
+
+    // Fetched again, as the changes applied since may have moved the roster
+    auto [__, attackRosterComps] = cm.getUnique<HiveRosterComponent>();
+    attackRosterComps.inspect(
+        [&](const HiveRosterComponent &roster) { handleHiveAttack(cm, res, roster, changes); });
+    applyHiveAttacks(cm, res, changes);
+    handleUFOAttack(cm, res);
 
     return cleanup;
 };
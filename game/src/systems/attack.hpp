@@ -14,6 +14,7 @@ inline void cleanup(ComponentManager &cm)
 
 inline void removeExpiredAttackAffects(ComponentManager &cm)
 {
+    double now = Utilities::getSimTime(cm);
     auto [attackEffectSet] = cm.getAll<AttackEffect>();
     attackEffectSet.each([&](EId eId, auto &attackEffects) {
         // clang-format off
@@ -23,7 +24,7 @@ inline void removeExpiredAttackAffects(ComponentManager &cm)
                 // needs to be cleaned up. This limits attacking to a single shot
                 // on the screen at a time
                 auto [projectileComps] = cm.get<ProjectileComponent>(effect.attackId);
-                return !projectileComps || effect.timer->hasElapsed();
+                return !projectileComps || effect.simTimer.hasElapsed(now);
             })
             .mutate([&](auto &effect) { effect.cleanup = true; });
         // clang-format on
@@ -33,6 +34,7 @@ inline void removeExpiredAttackAffects(ComponentManager &cm)
 // Take attack events and convert those into attack, then create attack effects which hold attack info
 inline void processAttacks(ComponentManager &cm)
 {
+    double now = Utilities::getSimTime(cm);
     auto [attackEventSet] = cm.getAll<AttackEvent>();
     attackEventSet.each([&](EId eId, auto &attackEvents) {
         attackEvents.inspect([&](const AttackEvent &attackEvent) {
@@ -58,7 +60,7 @@ inline void processAttacks(ComponentManager &cm)
                 return;
             }
 
-            cm.add<AttackEffect>(eId, projectileId, attackEvent.timeout);
+            Timers::add<AttackEffect>(cm, eId, projectileId, attackEvent.timeout, now);
         });
     });
 }
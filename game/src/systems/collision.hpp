@@ -2,63 +2,158 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../resources.hpp"
+#include "../tags.hpp"
+#include <algorithm>
 
 namespace Systems::Collision
 {
+using Contact = ContactBufferComponent::Contact;
+using Hit = ContactBufferComponent::Hit;
+using Candidate = ContactBufferComponent::Candidate;
+
 inline void cleanup(ComponentManager &cm)
 {
 }
 
-inline bool checkFriendlyFire(ComponentManager &cm, auto &projectileComps, auto &hiveAiComps)
+// Aliens' projectiles pass through aliens, and players' projectiles pass through players and other players'
+// projectiles
+inline bool checkFriendlyFire(ComponentManager &cm, const std::vector<uint32_t> &tagMasks, EId projectileId,
+                              EId targetId)
 {
-    if (!projectileComps || !hiveAiComps)
+    if (!TagMask::hasAny<ProjectileComponent>(tagMasks, projectileId) ||
+        !TagMask::hasAny<HiveAIComponent, PlayerComponent, ProjectileComponent>(tagMasks, targetId))
         return false;
 
+    auto [projectileComps] = cm.get<ProjectileComponent>(projectileId);
     using Movement = decltype(ProjectileComponent::movement);
     auto &movement = projectileComps.peek(&ProjectileComponent::movement);
-    return hiveAiComps && movement == Movement::DOWN;
+    if (TagMask::hasAny<PlayerComponent>(tagMasks, targetId))
+        return movement == Movement::UP;
+    if (auto [targetComps] = cm.get<ProjectileComponent>(targetId); targetComps)
+        return movement == Movement::UP && targetComps.peek(&ProjectileComponent::movement) == Movement::UP &&
+               projectileComps.peek(&ProjectileComponent::shooterId) !=
+                   targetComps.peek(&ProjectileComponent::shooterId);
+
+    return movement == Movement::DOWN;
+}
+
+// Hives can cross each other's paths, so aliens pass through one another, as players and UFOs do
+inline bool checkAllies(const std::vector<uint32_t> &tagMasks, EId eId1, EId eId2)
+{
+    return (TagMask::hasAny<HiveAIComponent>(tagMasks, eId1) &&
+            TagMask::hasAny<HiveAIComponent>(tagMasks, eId2)) ||
+           (TagMask::hasAny<PlayerComponent>(tagMasks, eId1) &&
+            TagMask::hasAny<PlayerComponent>(tagMasks, eId2)) ||
+           (TagMask::hasAny<UFOAIComponent>(tagMasks, eId1) &&
+            TagMask::hasAny<UFOAIComponent>(tagMasks, eId2));
+}
+
+inline bool checkOverlap(const Bounds &checkBounds, const Bounds &positionBounds)
+{
+    auto [cX, cY, cW, cH] = checkBounds.box();
+    auto [pX, pY, pW, pH] = positionBounds.box();
+    bool isX = (cX >= pX && cX <= pW) || (cW >= pX && cW <= pW);
+    bool isY = (cY >= pY && cY <= pH) || (cH >= pY && cH <= pH);
+
+    return isX && isY;
+}
+
+// Gather every collidable entity once per frame, with its check bounds if it moved, so the narrowphase
+// doesn't look the check event up again for every pair
+inline void gatherCandidates(ComponentManager &cm, std::vector<Candidate> &candidates)
+{
+    candidates.clear();
+    cm.getGroup<CollidableComponent, PositionComponent>().each([&](EId eId, auto &, auto &positionComps) {
+        auto [checkEvents] = cm.get<CollisionCheckEvent>(eId);
+        candidates.push_back(Candidate{eId, &positionComps.peek(&PositionComponent::bounds),
+                                       checkEvents ? &checkEvents.peek(&CollisionCheckEvent::bounds)
+                                                   : nullptr});
+    });
 }
 
-// Check for collisions and assign damage events and/or powerup events if no friendly fire is detected
-inline void handleCollisions(ComponentManager &cm)
+// Find each pair of colliding entities once, if no friendly fire is detected.  When both entities are
+// checking for collisions and collidable, the pair is only tested from the lower id, against both movements
+inline void findContacts(ComponentManager &cm, const std::vector<uint32_t> &tagMasks,
+                         const std::vector<Candidate> &candidates, std::vector<Contact> &contacts)
 {
     auto [collisionCheckEventSet] = cm.getAll<CollisionCheckEvent>();
-    collisionCheckEventSet.each([&](EId eId1, auto &checkEvents) {
-        auto [projectile1, hiveAiComps1] = cm.get<ProjectileComponent, HiveAIComponent>(eId1);
-        auto [cX, cY, cW, cH] = checkEvents.peek(&CollisionCheckEvent::bounds).box();
-        cm.getGroup<CollidableComponent, PositionComponent>().each(
-            [&](EId eId2, auto &collidableComps2, auto &positionComps2) {
-                if (eId1 == eId2)
-                    return;
-
-                auto [projectile2, hiveAiComps2] = cm.get<ProjectileComponent, HiveAIComponent>(eId2);
-                if (checkFriendlyFire(cm, projectile2, hiveAiComps1) ||
-                    checkFriendlyFire(cm, projectile1, hiveAiComps2))
-                    return;
-
-                auto [pX, pY, pW, pH] = positionComps2.peek(&PositionComponent::bounds).box();
-                bool isX = (cX >= pX && cX <= pW) || (cW >= pX && cW <= pW);
-                bool isY = (cY >= pY && cY <= pH) || (cH >= pY && cH <= pH);
-                if (!isX || !isY)
-                    return;
-
-                if (cm.contains<PowerupComponent>(eId2))
-                {
-                    cm.add<PowerupEvent>(eId1);
-                    cm.add<DamageEvent>(eId2, eId1);
-                }
-
-                EId dealer1 = projectile1 ? projectile1.peek(&ProjectileComponent::shooterId) : eId1;
-                EId dealer2 = projectile2 ? projectile2.peek(&ProjectileComponent::shooterId) : eId2;
-                cm.add<DamageEvent>(eId1, dealer2);
-                cm.add<DamageEvent>(eId2, dealer1);
-            });
+    collisionCheckEventSet.each([&](EId eId1, auto &checkEvents1) {
+        auto [positionComps1] = cm.get<PositionComponent>(eId1);
+        bool isCollidable1 = TagMask::hasAny<CollidableComponent>(tagMasks, eId1) && positionComps1;
+        auto &checkBounds1 = checkEvents1.peek(&CollisionCheckEvent::bounds);
+        for (const auto &[eId2, bounds2, checkBounds2] : candidates)
+        {
+            if (eId1 == eId2)
+                continue;
+
+            bool isMutual = checkBounds2 && isCollidable1;
+            if (isMutual && eId1 > eId2)
+                continue;
+
+            if (checkFriendlyFire(cm, tagMasks, eId2, eId1) || checkFriendlyFire(cm, tagMasks, eId1, eId2) ||
+                checkAllies(tagMasks, eId1, eId2))
+                continue;
+
+            bool isContact = checkOverlap(checkBounds1, *bounds2);
+            if (!isContact && isMutual)
+                isContact = checkOverlap(*checkBounds2, positionComps1.peek(&PositionComponent::bounds));
+
+            if (isContact)
+                contacts.push_back(Contact{std::min(eId1, eId2), std::max(eId1, eId2)});
+        }
+    });
+}
+
+// Turn each contact into damage for both entities, and a powerup for an entity touching a powerup.  When
+// combat is fused, damage is recorded as hits for the combat system instead of as events
+inline void resolveContacts(ComponentManager &cm, const std::vector<uint32_t> &tagMasks,
+                            const std::vector<Contact> &contacts, std::vector<Hit> &hits, bool isFused)
+{
+    auto addDamage = [&](EId targetId, EId dealerId) {
+        if (isFused)
+            hits.push_back(Hit{targetId, dealerId});
+        else
+            cm.add<DamageEvent>(targetId, dealerId);
+    };
+
+    for (const auto &[eId1, eId2] : contacts)
+    {
+        auto [projectile1] = cm.get<ProjectileComponent>(eId1);
+        auto [projectile2] = cm.get<ProjectileComponent>(eId2);
+        if (TagMask::hasAny<PowerupComponent>(tagMasks, eId2))
+        {
+            cm.add<PowerupEvent>(eId1);
+            addDamage(eId2, eId1);
+        }
+        if (TagMask::hasAny<PowerupComponent>(tagMasks, eId1))
+        {
+            cm.add<PowerupEvent>(eId2);
+            addDamage(eId1, eId2);
+        }
+
+        EId dealer1 = projectile1 ? projectile1.peek(&ProjectileComponent::shooterId) : eId1;
+        EId dealer2 = projectile2 ? projectile2.peek(&ProjectileComponent::shooterId) : eId2;
+        addDamage(eId1, dealer2);
+        addDamage(eId2, dealer1);
+    }
+}
+
+inline void handleCollisions(ComponentManager &cm, Resources &res)
+{
+    bool isFused = res.gameMeta.peek(&GameMetaComponent::fusedCombat);
+    auto [bufferId, contactBufferComps] = cm.getUnique<ContactBufferComponent>();
+    contactBufferComps.mutate([&](ContactBufferComponent &buffer) {
+        buffer.contacts.clear();
+        gatherCandidates(cm, buffer.candidates);
+        findContacts(cm, res.getTagMasks(), buffer.candidates, buffer.contacts);
+        resolveContacts(cm, res.getTagMasks(), buffer.contacts, buffer.hits, isFused);
     });
 }
 
-inline auto update(ComponentManager &cm)
+inline auto update(ComponentManager &cm, Resources &res)
 {
-    handleCollisions(cm);
+    handleCollisions(cm, res);
 
     return cleanup;
 };
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "../components.hpp"
+#include "../core.hpp"
+#include "../resources.hpp"
+#include "../utilities.hpp"
+#include "health.hpp"
+#include "score.hpp"
+#include <cstdint>
+
+/**
+ * @brief Optional replacement for the Damage, Health and Death systems.  Hits recorded in the contact buffer
+ * are applied straight to health, and the resulting deaths are resolved along with their score, in a single
+ * pass without creating damage, health, death or score events
+ */
+namespace Systems::Combat
+{
+struct Death
+{
+    EntityId id;
+    EntityId killedBy;
+};
+
+/**
+ * @brief Scratch space for the combat pass. Kept on the thread rather than in the component manager, so it
+ * stays put while the pass adds and removes components, and reused every frame so it doesn't allocate once
+ * grown
+ */
+struct Scratch
+{
+    std::vector<Death> deaths{};
+    std::vector<EntityId> resolvedIds{};
+};
+
+inline Scratch &getScratch()
+{
+    thread_local Scratch scratch{};
+    return scratch;
+}
+
+inline void cleanup(ComponentManager &cm)
+{
+}
+
+// Apply each hit to its target's health in the order the hits occurred, and collect the deaths they cause
+inline void applyHits(ComponentManager &cm, Resources &res,
+                      const std::vector<ContactBufferComponent::Hit> &hits, std::vector<Death> &deaths)
+{
+    auto &tagMasks = res.getTagMasks();
+    for (const auto &hit : hits)
+    {
+        auto [damageComps] = cm.get<DamageComponent>(hit.dealerId);
+        auto [healthComps] = cm.get<HealthComponent>(hit.targetId);
+        if (!damageComps || !healthComps)
+            continue;
+
+        int32_t amount = -1 * damageComps.peek(&DamageComponent::amount);
+        healthComps.mutate([&](HealthComponent &healthComp) {
+            healthComp.current += amount;
+            if (healthComp.current <= 0)
+                deaths.push_back(Death{hit.targetId, hit.dealerId});
+
+            Health::showDamage(cm, tagMasks, hit.targetId);
+        });
+    }
+}
+
+// Resolve deaths the same way as the Death system, awarding score directly instead of through score events
+inline void resolveDeaths(ComponentManager &cm, Resources &res, const std::vector<Death> &deaths,
+                          std::vector<EntityId> &resolvedIds)
+{
+    for (const auto &death : deaths)
+    {
+        bool isFirst = !Utilities::containsId(resolvedIds, death.id);
+        if (isFirst)
+            resolvedIds.push_back(death.id);
+
+        if (TagMask::hasAny<PlayerComponent>(res.getTagMasks(), death.id))
+        {
+            PRINT("PLAYER KILLED BY ", death.killedBy)
+            if (isFirst)
+                cm.add<PlayerEvent>(death.id, PlayerEvents::DEATH);
+            continue;
+        }
+
+        if (isFirst && death.id == res.startTriggerId)
+            cm.add<GameEvent>(death.id, GameEvents::NEXT_STAGE);
+
+        if (cm.contains<PointsComponent>(death.id))
+            Score::award(cm, res, death.killedBy, death.id);
+
+        if (isFirst)
+            cm.add<DeathComponent>(death.id);
+    }
+}
+
+inline auto update(ComponentManager &cm, Resources &res)
+{
+    if (!res.gameMeta.peek(&GameMetaComponent::fusedCombat))
+        return cleanup;
+
+    auto &deaths = getScratch().deaths;
+    auto &resolvedIds = getScratch().resolvedIds;
+    deaths.clear();
+    resolvedIds.clear();
+
+    // Deaths from other systems are resolved first, as they would be by the Death system, and consumed so
+    // the Death system has nothing left to do
+    auto [deathSet] = cm.getAll<DeathEvent>();
+    deathSet.each([&](EId eId, auto &deathEvents) {
+        deathEvents.inspect(
+            [&](const DeathEvent &deathEvent) { deaths.push_back(Death{eId, deathEvent.killedBy}); });
+    });
+    cm.clear<DeathEvent>();
+
+    auto [bufferId, contactBufferComps] = cm.getUnique<ContactBufferComponent>();
+    contactBufferComps.mutate([&](ContactBufferComponent &buffer) {
+        applyHits(cm, res, buffer.hits, deaths);
+        buffer.hits.clear();
+    });
+
+    resolveDeaths(cm, res, deaths, resolvedIds);
+
+    return cleanup;
+};
+}; // namespace Systems::Combat
@@ -2,23 +2,23 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../recycler.hpp"
+#include "../resources.hpp"
+#include "../tags.hpp"
 
 namespace Systems::Death
 {
 inline void cleanup(ComponentManager &cm)
 {
-    auto &deadIds = cm.getEntityIds<DeathComponent>();
-    for (const auto &id : deadIds)
-        cm.remove(id);
+    Recycler::destroy(cm, cm.getEntityIds<DeathComponent>());
 }
 
 // Handle creating score events, assign death states, and handle player deaths in a special way
-inline auto update(ComponentManager &cm)
+inline auto update(ComponentManager &cm, Resources &res)
 {
     auto [deathSet] = cm.getAll<DeathEvent>();
     deathSet.each([&](EId eId, ECS::Components<DeathEvent> &deathEvents) {
-        auto [playerId, _] = cm.getUnique<PlayerComponent>();
-        if (eId == playerId)
+        if (TagMask::hasAny<PlayerComponent>(res.getTagMasks(), eId))
         {
             deathEvents.inspect(
                 [&](const DeathEvent &deathEvent) { PRINT("PLAYER KILLED BY ", deathEvent.killedBy) });
@@ -26,8 +26,7 @@ inline auto update(ComponentManager &cm)
             return;
         }
 
-        auto [startTriggerId, _] = cm.getUnique<StartGameTriggerComponent>();
-        if (eId == startTriggerId)
+        if (eId == res.startTriggerId)
         {
             cm.add<GameEvent>(eId, GameEvents::NEXT_STAGE);
         }
@@ -2,6 +2,7 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../recycler.hpp"
 #include "../utilities.hpp"
 
 namespace Systems::Game
@@ -28,8 +29,9 @@ inline auto update(ComponentManager &cm)
                 case GameEvents::GAME_OVER: {
                     PRINT("GAME OVER")
                     Utilities::goToStage(cm, -999);
-                    auto [playerId, _] = cm.getUnique<PlayerComponent>();
-                    cm.add<DeactivatedComponent>(playerId);
+                    for (const auto &playerId : cm.getEntityIds<PlayerComponent>())
+                        if (!TagMask::hasAny<DeactivatedComponent>(cm, playerId))
+                            TagMask::add<DeactivatedComponent>(cm, playerId);
                     break;
                 }
                 case GameEvents::NEXT_STAGE: {
@@ -37,14 +39,16 @@ inline auto update(ComponentManager &cm)
                     if (eId == startTriggerId)
                     {
                         gameComp.currentStage = 1;
+                        gameComp.difficultyModifier = Utilities::calculateDifficultyModifier(1);
                         Utilities::goToStage(cm, gameComp.currentStage);
-                        auto entities = cm.getEntityIds<TitleScreenComponent>();
-                        cm.remove(entities);
+                        Recycler::destroy(cm, cm.getEntityIds<TitleScreenComponent>());
                     }
                     else
                     {
                         PRINT("STAGE CLEARED!!")
-                        Utilities::goToStage(cm, ++gameComp.currentStage);
+                        int stage = ++gameComp.currentStage;
+                        gameComp.difficultyModifier = Utilities::calculateDifficultyModifier(stage);
+                        Utilities::goToStage(cm, stage);
                     }
                     break;
                 }
@@ -2,6 +2,8 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../render_list.hpp"
+#include "../tags.hpp"
 #include <cstdint>
 
 namespace Systems::Health
@@ -10,9 +12,28 @@ inline void cleanup(ComponentManager &cm)
 {
 }
 
+// Update obstacle color to reflect damage
+inline void showDamage(ComponentManager &cm, const std::vector<uint32_t> &tagMasks, EId eId)
+{
+    if (!TagMask::hasAny<ObstacleComponent>(tagMasks, eId))
+        return;
+
+    auto [spriteComps] = cm.get<SpriteComponent>(eId);
+    spriteComps.mutate([&](SpriteComponent &spriteComp) {
+        auto [r, g, b, a] = spriteComp.rgba;
+        uint8_t change = 20;
+        spriteComp.rgba.r -= r >= change ? change : 0;
+        spriteComp.rgba.g -= g >= change ? change : 0;
+        spriteComp.rgba.b -= b >= change ? change : 0;
+        spriteComp.rgba.a -= a >= change ? change : 0;
+    });
+    RenderList::markDirty(cm, eId);
+}
+
 // Handle health changes, create death events, and update color to reflect damages
 inline auto update(ComponentManager &cm)
 {
+    auto &tagMasks = TagMask::getMasks(cm);
     cm.getGroup<HealthEvent, HealthComponent>().each([&](EId eId, auto &healthEvents, auto &healthComps) {
         healthEvents.inspect([&](const HealthEvent &healthEvent) {
             healthComps.mutate([&](HealthComponent &healthComp) {
@@ -20,19 +41,7 @@ inline auto update(ComponentManager &cm)
                 if (healthComp.current <= 0)
                     cm.add<DeathEvent>(eId, healthEvent.dealerId);
 
-                if (!cm.contains<ObstacleComponent>(eId))
-                    return;
-
-                // Update obstacle color to reflect damage
-                auto [spriteComps] = cm.get<SpriteComponent>(eId);
-                spriteComps.mutate([&](SpriteComponent &spriteComp) {
-                    auto [r, g, b, a] = spriteComp.rgba;
-                    uint8_t change = 20;
-                    spriteComp.rgba.r -= r >= change ? change : 0;
-                    spriteComp.rgba.g -= g >= change ? change : 0;
-                    spriteComp.rgba.b -= b >= change ? change : 0;
-                    spriteComp.rgba.a -= a >= change ? change : 0;
-                });
+                showDamage(cm, tagMasks, eId);
             });
         });
     });
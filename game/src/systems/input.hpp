@@ -17,7 +17,7 @@ inline void movePlayer(ComponentManager &cm)
     auto [playerInputEventSet] = cm.getAll<PlayerInputEvent>();
 
     playerInputEventSet.each([&](EId eId, auto &playerInputEvents) {
-        bool isDeactivated = cm.contains<DeactivatedComponent>(eId);
+        bool isDeactivated = TagMask::hasAny<DeactivatedComponent>(cm, eId);
 
         auto [movementComps] = cm.get<MovementComponent>(eId);
         auto &speeds = movementComps.peek(&MovementComponent::speeds);
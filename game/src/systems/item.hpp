@@ -3,25 +3,34 @@
 #include "../components.hpp"
 #include "../core.hpp"
 #include "../entities.hpp"
+#include "../random.hpp"
 #include "../utilities.hpp"
-#include <cstdlib>
 
 namespace Systems::Item
 {
 inline void cleanup(ComponentManager &cm)
 {
-    Utilities::cleanupEffect<PowerupTimeoutEffect, PowerupEffect>(cm);
 }
 
-// Creates a new power in specified intervals IF the player doesn't already have a powerup
+// Find the first player without a powerup, or 0 if every player has one
+inline EntityId findPlayerWithoutPowerup(ComponentManager &cm)
+{
+    for (const auto &id : cm.getEntityIds<PlayerComponent>())
+        if (!cm.contains<PowerupEffect>(id))
+            return id;
+
+    return 0;
+}
+
+// Creates a new power in specified intervals IF any player doesn't already have a powerup
 inline void spawnPowerup(ComponentManager &cm)
 {
     auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
     if (cm.contains<PowerupTimeoutEffect>(gameId))
         return;
 
-    auto [playerId, _] = cm.getUnique<PlayerComponent>();
-    if (cm.contains<PowerupEffect>(playerId))
+    auto playerId = findPlayerWithoutPowerup(cm);
+    if (!playerId)
         return;
 
     auto [positionComps] = cm.get<PositionComponent>(playerId);
@@ -30,16 +39,20 @@ inline void spawnPowerup(ComponentManager &cm)
     auto &screenSize = gameMetaComps.peek(&GameMetaComponent::screen);
     float tileSize = gameMetaComps.peek(&GameMetaComponent::tileSize);
 
-    float randomX = std::rand() % static_cast<int>(screenSize.x - tileSize);
+    float randomX = Random::next(cm) % static_cast<int>(screenSize.x - tileSize);
     createPowerup(cm, Bounds{randomX + tileSize, playerPos.position.y, tileSize, tileSize});
-    cm.add<PowerupTimeoutEffect>(gameId);
+    Timers::add<PowerupTimeoutEffect>(cm, gameId, gameMetaComps.peek(&GameMetaComponent::simTime));
 }
 
 inline void processEvents(ComponentManager &cm)
 {
+    double now = Utilities::getSimTime(cm);
     auto &powerupEventIds = cm.getEntityIds<PowerupEvent>();
     for (const auto &id : powerupEventIds)
-        cm.add<PowerupEffect>(id);
+        Timers::add<PowerupEffect>(cm, id, now);
+
+    if (!powerupEventIds.empty())
+        Utilities::invalidateTransformations(cm);
 }
 
 inline auto update(ComponentManager &cm)
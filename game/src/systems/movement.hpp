@@ -2,6 +2,7 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../resources.hpp"
 #include "../utilities.hpp"
 
 namespace Systems::Movement
@@ -59,15 +60,15 @@ inline void applyMovementEffects(ComponentManager &cm)
 }
 
 // Update movement from movement events
-inline void updateMovement(ComponentManager &cm)
+inline void updateMovement(ComponentManager &cm, Resources &res)
 {
+    auto &gameBounds = res.game.peek(&GameComponent::bounds);
+    auto [gX, gY, gW, gH] = gameBounds.box();
+    auto &tagMasks = res.getTagMasks();
     auto [movementEventSet] = cm.getAll<MovementEvent>();
     movementEventSet.each([&](EId eId, auto &movementEvents) {
         auto [positionComps] = cm.get<PositionComponent>(eId);
         positionComps.inspect([&](const PositionComponent &positionComp) {
-            auto [gameId, gameComps] = cm.getUnique<GameComponent>();
-            auto &gameBounds = gameComps.peek(&GameComponent::bounds);
-            auto [gX, gY, gW, gH] = gameBounds.box();
 
             auto newBounds = calculateNewBounds(movementEvents, positionComp);
             auto [newX, newY, newW, newH] = newBounds.box();
@@ -76,7 +77,7 @@ inline void updateMovement(ComponentManager &cm)
             // TODO Task : Move boundary checks to collision system
             if (checkOutOfBounds(gameBounds, newBounds))
             {
-                if (!cm.contains<ProjectileComponent>(eId) && !cm.contains<UFOAIComponent>(eId))
+                if (!TagMask::hasAny<ProjectileComponent, UFOAIComponent>(tagMasks, eId))
                     return;
 
                 if (newH < gY || newY > gH || newW < gX || newX > gW)
@@ -93,10 +94,10 @@ inline void updateMovement(ComponentManager &cm)
     });
 }
 
-inline auto update(ComponentManager &cm)
+inline auto update(ComponentManager &cm, Resources &res)
 {
     applyMovementEffects(cm);
-    updateMovement(cm);
+    updateMovement(cm, res);
 
     return cleanup;
 };
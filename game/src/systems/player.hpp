@@ -2,6 +2,7 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../tags.hpp"
 
 namespace Systems::Player
 {
@@ -9,9 +10,41 @@ inline void cleanup(ComponentManager &cm)
 {
 }
 
+/**
+ * @brief Check if any player other than the given one has lives left
+ */
+inline bool hasOtherPlayerLives(ComponentManager &cm, EntityId playerId)
+{
+    for (const auto &id : cm.getEntityIds<PlayerComponent>())
+    {
+        auto [livesComps] = cm.get<LivesComponent>(id);
+        if (id != playerId && livesComps.peek(&LivesComponent::count) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief A player out of lives leaves play, and the game is over once every player is out
+ */
+inline void handleOutOfLives(ComponentManager &cm, EntityId playerId)
+{
+    if (!hasOtherPlayerLives(cm, playerId))
+    {
+        cm.add<GameEvent>(playerId, GameEvents::GAME_OVER);
+        return;
+    }
+    if (TagMask::hasAny<DeactivatedComponent>(cm, playerId))
+        return;
+
+    PRINT("PLAYER", playerId, "IS OUT")
+    TagMask::add<DeactivatedComponent>(cm, playerId);
+    TagMask::remove<CollidableComponent>(cm, playerId);
+}
+
 inline auto update(ComponentManager &cm)
 {
-    auto [playerId, playerComps] = cm.getUnique<PlayerComponent>();
     auto [playerEventSet] = cm.getAll<PlayerEvent>();
     playerEventSet.each([&](EId eId, auto &playerEvents) {
         playerEvents.inspect([&](const PlayerEvent &playerEvent) {
@@ -19,12 +52,12 @@ inline auto update(ComponentManager &cm)
             switch (playerEvent.event)
             {
             case Event::DEATH: {
-                auto [livesComps] = cm.get<LivesComponent>(playerId);
+                auto [livesComps] = cm.get<LivesComponent>(eId);
                 livesComps.mutate([&](LivesComponent &livesComp) { --livesComp.count; });
                 auto &lifeCount = livesComps.peek(&LivesComponent::count);
                 cm.add<UIEvent>(eId, UIEvents::UPDATE_LIVES);
                 if (lifeCount <= 0)
-                    cm.add<GameEvent>(eId, GameEvents::GAME_OVER);
+                    handleOutOfLives(cm, eId);
 
                 break;
             }
@@ -2,6 +2,7 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../render_list.hpp"
 
 namespace Systems::Position
 {
@@ -19,6 +20,7 @@ inline auto update(ComponentManager &cm)
                 positionComp.bounds.position.x = positionEvent.coords.x;
                 positionComp.bounds.position.y = positionEvent.coords.y;
             });
+            RenderList::markDirty(cm, eId);
         });
     });
 
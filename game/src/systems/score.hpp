@@ -2,6 +2,8 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../resources.hpp"
+#include "../tags.hpp"
 
 namespace Systems::Score
 {
@@ -9,24 +11,26 @@ inline void cleanup(ComponentManager &cm)
 {
 }
 
-inline auto update(ComponentManager &cm)
+// Add the points of one entity to the score of another
+inline void award(ComponentManager &cm, Resources &res, EId eId, EntityId pointsId)
 {
-    auto [scoreEventSet] = cm.getAll<ScoreEvent>();
-    scoreEventSet.each([&](EId eId, auto &scoreEvents) {
-        scoreEvents.inspect([&](const ScoreEvent &scoreEvent) {
-            auto [pointsComps] = cm.get<PointsComponent>(scoreEvent.pointsId);
-            if (!pointsComps)
-                return;
+    auto [pointsComps] = cm.get<PointsComponent>(pointsId);
+    if (!pointsComps)
+        return;
 
-            auto [points, multiplier] =
-                pointsComps.peek(&PointsComponent::points, &PointsComponent::multiplier);
-            auto [scoreComps] = cm.get<ScoreComponent>(eId);
-            scoreComps.mutate([&](ScoreComponent &scoreComp) { scoreComp.score += (points * multiplier); });
+    auto [points, multiplier] = pointsComps.peek(&PointsComponent::points, &PointsComponent::multiplier);
+    auto [scoreComps] = cm.get<ScoreComponent>(eId);
+    scoreComps.mutate([&](ScoreComponent &scoreComp) { scoreComp.score += (points * multiplier); });
+
+    if (TagMask::hasAny<PlayerComponent>(res.getTagMasks(), eId))
+        cm.add<UIEvent>(eId, UIEvents::UPDATE_SCORE);
+}
 
-            auto [playerId, _] = cm.getUnique<PlayerComponent>();
-            if (eId == playerId)
-                cm.add<UIEvent>(eId, UIEvents::UPDATE_SCORE);
-        });
+inline auto update(ComponentManager &cm, Resources &res)
+{
+    auto [scoreEventSet] = cm.getAll<ScoreEvent>();
+    scoreEventSet.each([&](EId eId, auto &scoreEvents) {
+        scoreEvents.inspect([&](const ScoreEvent &scoreEvent) { award(cm, res, eId, scoreEvent.pointsId); });
     });
 
     return cleanup;
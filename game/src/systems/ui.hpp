@@ -2,6 +2,9 @@
 
 #include "../components.hpp"
 #include "../core.hpp"
+#include "../entities.hpp"
+#include "../render_list.hpp"
+#include <string_view>
 
 namespace Systems::UI
 {
@@ -9,31 +12,40 @@ inline void cleanup(ComponentManager &cm)
 {
 }
 
+// Update the text of one of a player's cards
+inline void updateCard(ComponentManager &cm, EntityId cardId, uint32_t index, std::string_view label,
+                       int value)
+{
+    auto [textComps] = cm.get<TextComponent>(cardId);
+    textComps.mutate(
+        [&](TextComponent &textComp) { textComp.text = getPlayerCardText(index, label, value); });
+    RenderList::markDirty(cm, cardId);
+}
+
+// UI events are raised on the player whose cards changed
 inline auto update(ComponentManager &cm)
 {
     auto [uiEventSet] = cm.getAll<UIEvent>();
     uiEventSet.each([&](EId eId, auto &uiEvents) {
+        auto [playerComps] = cm.get<PlayerComponent>(eId);
+        if (!playerComps)
+            return;
+
+        auto &index = playerComps.peek(&PlayerComponent::index);
         uiEvents.inspect([&](const UIEvent &uiEvent) {
-            auto [playerId, playerComps] = cm.getUnique<PlayerComponent>();
             using Event = decltype(uiEvent.event);
             switch (uiEvent.event)
             {
             case Event::UPDATE_SCORE: {
-                auto [scoreComps] = cm.get<ScoreComponent>(playerId);
+                auto [scoreComps] = cm.get<ScoreComponent>(eId);
                 auto &score = scoreComps.peek(&ScoreComponent::score);
-                auto [playerScoreId, _] = cm.getUnique<PlayerScoreCardComponent>();
-                auto [textComps] = cm.get<TextComponent>(playerScoreId);
-                textComps.mutate(
-                    [&](TextComponent &textComp) { textComp.text = "SCORE: " + std::to_string(score); });
+                updateCard(cm, playerComps.peek(&PlayerComponent::scoreCardId), index, "SCORE", score);
                 break;
             }
             case Event::UPDATE_LIVES: {
-                auto [livesComps] = cm.get<LivesComponent>(playerId);
+                auto [livesComps] = cm.get<LivesComponent>(eId);
                 auto &lives = livesComps.peek(&LivesComponent::count);
-                auto [playerLifeCardId, _] = cm.getUnique<PlayerLifeCardComponent>();
-                auto [textComps] = cm.get<TextComponent>(playerLifeCardId);
-                textComps.mutate(
-                    [&](TextComponent &textComp) { textComp.text = "LIVES: " + std::to_string(lives); });
+                updateCard(cm, playerComps.peek(&PlayerComponent::lifeCardId), index, "LIVES", lives);
                 break;
             }
             }
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include <cstdint>
+
+/**
+ * @brief Dense per-entity bitmask mirroring the marker components, so loops can test several of them with a
+ * single load and mask instead of probing each component set.  Tags are kept in sync by adding them through
+ * TagMask::add, and by clearing an entity's mask whenever the entity is removed.
+ */
+namespace TagMask
+{
+template <typename T> struct Bit;
+
+// clang-format off
+template <> struct Bit<UIComponent> { static constexpr uint32_t value = 1u << 0; };
+template <> struct Bit<ObstacleComponent> { static constexpr uint32_t value = 1u << 1; };
+template <> struct Bit<ProjectileComponent> { static constexpr uint32_t value = 1u << 2; };
+template <> struct Bit<UFOAIComponent> { static constexpr uint32_t value = 1u << 3; };
+template <> struct Bit<PowerupComponent> { static constexpr uint32_t value = 1u << 4; };
+template <> struct Bit<DeactivatedComponent> { static constexpr uint32_t value = 1u << 5; };
+template <> struct Bit<HiveAIComponent> { static constexpr uint32_t value = 1u << 6; };
+template <> struct Bit<CollidableComponent> { static constexpr uint32_t value = 1u << 7; };
+template <> struct Bit<PlayerComponent> { static constexpr uint32_t value = 1u << 8; };
+// clang-format on
+
+template <typename... Ts> constexpr uint32_t maskOf()
+{
+    return (Bit<Ts>::value | ...);
+}
+
+inline uint32_t get(const std::vector<uint32_t> &masks, EntityId id)
+{
+    return id < masks.size() ? masks[id] : 0;
+}
+
+/**
+ * @brief Check if an entity has any of the tags
+ */
+template <typename... Ts> inline bool hasAny(const std::vector<uint32_t> &masks, EntityId id)
+{
+    return get(masks, id) & maskOf<Ts...>();
+}
+
+/**
+ * @brief Check if an entity has all of the tags
+ */
+template <typename... Ts> inline bool hasAll(const std::vector<uint32_t> &masks, EntityId id)
+{
+    return (get(masks, id) & maskOf<Ts...>()) == maskOf<Ts...>();
+}
+
+inline const std::vector<uint32_t> &getMasks(ComponentManager &cm)
+{
+    auto [_, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+    return tagMaskComps.peek(&TagMaskComponent::masks);
+}
+
+template <typename... Ts> inline bool hasAny(ComponentManager &cm, EntityId id)
+{
+    return hasAny<Ts...>(getMasks(cm), id);
+}
+
+/**
+ * @brief Add a marker component, and set its tag
+ */
+template <typename T, typename... Args> inline void add(ComponentManager &cm, EntityId id, Args &&...args)
+{
+    cm.add<T>(id, std::forward<Args>(args)...);
+    auto [_, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+    tagMaskComps.mutate([&](TagMaskComponent &tagMaskComp) {
+        if (id >= tagMaskComp.masks.size())
+            tagMaskComp.masks.resize(id + 1);
+        tagMaskComp.masks[id] |= Bit<T>::value;
+    });
+}
+
+/**
+ * @brief Remove a marker component, and unset its tag
+ */
+template <typename T> inline void remove(ComponentManager &cm, EntityId id)
+{
+    cm.remove<T>(id);
+    auto [_, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+    tagMaskComps.mutate([&](TagMaskComponent &tagMaskComp) {
+        if (id < tagMaskComp.masks.size())
+            tagMaskComp.masks[id] &= ~Bit<T>::value;
+    });
+}
+
+/**
+ * @brief Clear all tags from an entity which is being removed
+ */
+inline void clear(ComponentManager &cm, EntityId id)
+{
+    auto [_, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+    tagMaskComps.mutate([&](TagMaskComponent &tagMaskComp) {
+        if (id < tagMaskComp.masks.size())
+            tagMaskComp.masks[id] = 0;
+    });
+}
+
+/**
+ * @brief Drop the masks above the highest tagged id, and release the memory once most of it is unused
+ */
+inline void compact(ComponentManager &cm)
+{
+    auto [_, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+    tagMaskComps.mutate([&](TagMaskComponent &tagMaskComp) {
+        auto &masks = tagMaskComp.masks;
+        while (!masks.empty() && !masks.back())
+            masks.pop_back();
+        if (masks.capacity() > masks.size() * 2)
+            masks.shrink_to_fit();
+    });
+}
+}; // namespace TagMask
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include "entities.hpp"
+#include "recycler.hpp"
+#include "render_list.hpp"
+#include <array>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+/**
+ * @brief Per tick counts of entities, components, effects and events, sampled from the component manager
+ * into a fixed length time series. Used to spot leaks, like effects which never clear, and churn around stage
+ * transitions.
+ */
+namespace Telemetry
+{
+enum class Kind
+{
+    COMPONENT,
+    EFFECT,
+    EVENT,
+};
+
+/**
+ * @brief Count the instances of a component type. Stacking types count every instance on each entity, so
+ * effects which pile up on a single entity still show
+ */
+template <typename T> inline uint32_t count(ComponentManager &cm)
+{
+    auto &ids = cm.getEntityIds<T>();
+    if constexpr (!std::is_base_of_v<Stack, T> && !std::is_base_of_v<Event, T>)
+        return static_cast<uint32_t>(ids.size());
+
+    uint32_t total{};
+    for (const auto &id : ids)
+    {
+        auto [comps] = cm.get<T>(id);
+        comps.inspect([&](const T &) { ++total; });
+    }
+
+    return total;
+}
+
+struct Column
+{
+    const char *name;
+    Kind kind;
+    uint32_t (*count)(ComponentManager &);
+};
+
+template <typename T> constexpr Column column(const char *name)
+{
+    constexpr Kind kind = std::is_base_of_v<Event, T>    ? Kind::EVENT
+                          : std::is_base_of_v<Effect, T> ? Kind::EFFECT
+                                                         : Kind::COMPONENT;
+    return Column{name, kind, &count<T>};
+}
+
+// clang-format off
+inline constexpr std::array COLUMNS{
+    column<PositionComponent>("PositionComponent"),
+    column<SpriteComponent>("SpriteComponent"),
+    column<TextComponent>("TextComponent"),
+    column<UIComponent>("UIComponent"),
+    column<CollidableComponent>("CollidableComponent"),
+    column<MovementComponent>("MovementComponent"),
+    column<HealthComponent>("HealthComponent"),
+    column<DamageComponent>("DamageComponent"),
+    column<AttackComponent>("AttackComponent"),
+    column<PointsComponent>("PointsComponent"),
+    column<AIComponent>("AIComponent"),
+    column<HiveAIComponent>("HiveAIComponent"),
+    column<UFOAIComponent>("UFOAIComponent"),
+    column<ProjectileComponent>("ProjectileComponent"),
+    column<ObstacleComponent>("ObstacleComponent"),
+    column<PowerupComponent>("PowerupComponent"),
+    column<DeactivatedComponent>("DeactivatedComponent"),
+    column<DeathComponent>("DeathComponent"),
+    column<AttackEffect>("AttackEffect"),
+    column<MovementEffect>("MovementEffect"),
+    column<AIMovementEffect>("AIMovementEffect"),
+    column<HiveMovementEffect>("HiveMovementEffect"),
+    column<AITimeoutEffect>("AITimeoutEffect"),
+    column<UFOTimeoutEffect>("UFOTimeoutEffect"),
+    column<UFOAttackTimeoutEffect>("UFOAttackTimeoutEffect"),
+    column<PowerupEffect>("PowerupEffect"),
+    column<PowerupTimeoutEffect>("PowerupTimeoutEffect"),
+    column<PlayerInputEvent>("PlayerInputEvent"),
+    column<AIInputEvent>("AIInputEvent"),
+    column<MovementEvent>("MovementEvent"),
+    column<PositionEvent>("PositionEvent"),
+    column<CollisionCheckEvent>("CollisionCheckEvent"),
+    column<AttackEvent>("AttackEvent"),
+    column<DamageEvent>("DamageEvent"),
+    column<HealthEvent>("HealthEvent"),
+    column<DeathEvent>("DeathEvent"),
+    column<ScoreEvent>("ScoreEvent"),
+    column<PowerupEvent>("PowerupEvent"),
+    column<PlayerEvent>("PlayerEvent"),
+    column<GameEvent>("GameEvent"),
+    column<UIEvent>("UIEvent"),
+};
+// clang-format on
+
+struct Sample
+{
+    uint64_t tick{};
+    // Entities alive, whichever components they hold
+    uint32_t entities{};
+    std::array<uint32_t, COLUMNS.size()> counts{};
+
+    uint32_t sum(Kind kind) const
+    {
+        uint32_t total{};
+        for (std::size_t i = 0; i < COLUMNS.size(); ++i)
+            if (COLUMNS[i].kind == kind)
+                total += counts[i];
+
+        return total;
+    }
+};
+
+/**
+ * @brief Ring of the most recent samples. Sampling writes in place, and takes the entities alive from the
+ * recycler's live count rather than collecting their ids, so it doesn't allocate.
+ */
+class Series
+{
+  public:
+    static constexpr uint64_t CAPACITY = 4096;
+
+    void sample(ComponentManager &cm)
+    {
+        auto &sample = m_samples[m_ticks % CAPACITY];
+        sample.tick = m_ticks++;
+        for (std::size_t i = 0; i < COLUMNS.size(); ++i)
+            sample.counts[i] = COLUMNS[i].count(cm);
+        sample.entities = Recycler::getEntityCount(cm);
+    }
+
+    uint64_t getTicks() const
+    {
+        return m_ticks;
+    }
+
+    const Sample &latest() const
+    {
+        return m_samples[(m_ticks + CAPACITY - 1) % CAPACITY];
+    }
+
+    /**
+     * @brief Write the retained samples, oldest first, with one column per counted type
+     */
+    bool writeCSV(const std::string &path) const
+    {
+        std::ofstream file{path};
+        if (!file)
+            return false;
+
+        file << "tick,entities";
+        for (const auto &column : COLUMNS)
+            file << "," << column.name;
+        file << "\n";
+
+        for (auto i = m_ticks > CAPACITY ? m_ticks - CAPACITY : 0; i < m_ticks; ++i)
+        {
+            const auto &sample = m_samples[i % CAPACITY];
+            file << sample.tick << "," << sample.entities;
+            for (const auto &count : sample.counts)
+                file << "," << count;
+            file << "\n";
+        }
+
+        return !!file;
+    }
+
+  private:
+    std::array<Sample, CAPACITY> m_samples{};
+    uint64_t m_ticks{};
+};
+
+// How many ticks apart the telemetry card text is refreshed
+constexpr uint64_t CARD_INTERVAL = 30;
+
+/**
+ * @brief Start sampling every tick, and optionally show the latest totals in a UI card
+ */
+inline void enable(ComponentManager &cm, bool showCard)
+{
+    auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    cm.add<TelemetryComponent>(gameId, std::make_shared<Series>());
+    if (!showCard)
+        return;
+
+    auto &screen = gameMetaComps.peek(&GameMetaComponent::screen);
+    float tileSize = gameMetaComps.peek(&GameMetaComponent::tileSize);
+    telemetryCard(cm, tileSize, screen.y - tileSize, tileSize, tileSize);
+}
+
+inline void updateCard(ComponentManager &cm, const Series &series)
+{
+    auto [cardId, _] = cm.getUnique<TelemetryCardComponent>();
+    if (!cardId || series.getTicks() % CARD_INTERVAL)
+        return;
+
+    const auto &sample = series.latest();
+    auto [textComps] = cm.get<TextComponent>(cardId);
+    textComps.mutate([&](TextComponent &textComp) {
+        textComp.text = "ENTITIES: " + std::to_string(sample.entities) +
+                        "  EFFECTS: " + std::to_string(sample.sum(Kind::EFFECT)) +
+                        "  EVENTS: " + std::to_string(sample.sum(Kind::EVENT));
+    });
+    RenderList::markDirty(cm, cardId);
+}
+
+/**
+ * @brief Record this tick's counts, if telemetry is enabled. Must run before events are cleared
+ */
+inline void sample(ComponentManager &cm)
+{
+    auto [_, telemetryComps] = cm.getUnique<TelemetryComponent>();
+    if (!telemetryComps)
+        return;
+
+    auto &series = *telemetryComps.peek(&TelemetryComponent::series);
+    series.sample(cm);
+    updateCard(cm, series);
+}
+
+inline bool writeCSV(ComponentManager &cm, const std::string &path)
+{
+    auto [_, telemetryComps] = cm.getUnique<TelemetryComponent>();
+    return telemetryComps && telemetryComps.peek(&TelemetryComponent::series)->writeCSV(path);
+}
+} // namespace Telemetry
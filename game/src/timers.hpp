@@ -0,0 +1,92 @@
+#pragma once
+
+#include "components.hpp"
+#include "core.hpp"
+#include <algorithm>
+#include <utility>
+
+/**
+ * @brief Schedules timed effects for removal when they are added, so expiring them only touches the effects
+ * which are due rather than every live effect each frame
+ */
+namespace Timers
+{
+using Expiry = EffectExpiryComponent::Expiry;
+
+inline bool isLater(const Expiry &a, const Expiry &b)
+{
+    return a.time > b.time;
+}
+
+/**
+ * @brief Remove the elapsed effects of one type from a single entity
+ */
+template <typename T> inline void expireEffect(ComponentManager &cm, EntityId id, double now)
+{
+    auto [effects] = cm.get<T>(id);
+    if (effects)
+        effects.remove([&](const T &effect) { return effect.simTimer.hasElapsed(now); });
+}
+
+template <typename T> inline void schedule(ComponentManager &cm, EntityId id, double time)
+{
+    auto [_, expiryComps] = cm.getUnique<EffectExpiryComponent>();
+    expiryComps.mutate([&](EffectExpiryComponent &expiryComp) {
+        expiryComp.queue.push_back(Expiry{time, id, &expireEffect<T>});
+        std::push_heap(expiryComp.queue.begin(), expiryComp.queue.end(), isLater);
+    });
+}
+
+/**
+ * @brief Add a timed effect, and schedule its removal for when its timer elapses
+ */
+template <typename T, typename... Args> inline void add(ComponentManager &cm, EntityId id, Args &&...args)
+{
+    T effect(std::forward<Args>(args)...);
+    double time = effect.simTimer.getExpiry();
+    cm.add<T>(id, std::move(effect));
+    schedule<T>(cm, id, time);
+}
+
+/**
+ * @brief Scratch space for the expiries due this frame. Kept on the thread rather than in the component
+ * manager, so it stays put while expiring removes components, and reused every frame so it doesn't allocate
+ * once grown
+ */
+inline std::vector<Expiry> &getDue()
+{
+    thread_local std::vector<Expiry> due{};
+    return due;
+}
+
+/**
+ * @brief Remove every effect which is due by the current simulation time.  Entries for effects which were
+ * removed early, or replaced, are harmless as only elapsed timers are removed.
+ *
+ * @return bool - Whether any effect was due
+ */
+inline bool expire(ComponentManager &cm)
+{
+    auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    double now = gameMetaComps.peek(&GameMetaComponent::simTime);
+
+    auto &due = getDue();
+    due.clear();
+    auto [expiryId, expiryComps] = cm.getUnique<EffectExpiryComponent>();
+    expiryComps.mutate([&](EffectExpiryComponent &expiryComp) {
+        auto &queue = expiryComp.queue;
+        while (!queue.empty() && queue.front().time <= now)
+        {
+            std::pop_heap(queue.begin(), queue.end(), isLater);
+            due.push_back(queue.back());
+            queue.pop_back();
+        }
+    });
+
+    // Expire outside of the mutation, as removing components may move the queue's storage
+    for (const auto &expiry : due)
+        expiry.expire(cm, expiry.id, now);
+
+    return !due.empty();
+}
+}; // namespace Timers
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+/**
+ * @brief Lightweight timeline tracing. Scopes are recorded into a ring owned by the recording thread, so
+ * recording never locks or allocates, and are exported as Chrome trace JSON which loads in chrome://tracing
+ * and Perfetto.
+ */
+namespace Trace
+{
+using Clock = std::chrono::steady_clock;
+
+struct Event
+{
+    const char *name;
+    int64_t start;
+    int64_t duration;
+};
+
+/**
+ * @brief Single producer ring of completed scopes. Only the owning thread writes, publishing each event by
+ * advancing the head. Exporting waits for the writers to stop first, see exportJson.
+ */
+class Ring
+{
+  public:
+    static constexpr uint64_t CAPACITY = 1 << 16;
+
+    Ring(uint32_t threadId) : threadId(threadId)
+    {
+    }
+
+    void push(const Event &event)
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        m_events[head % CAPACITY] = event;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    template <typename Fn> void each(Fn &&fn) const
+    {
+        auto head = m_head.load(std::memory_order_acquire);
+        for (auto i = head > CAPACITY ? head - CAPACITY : 0; i < head; ++i)
+            fn(m_events[i % CAPACITY]);
+    }
+
+    const uint32_t threadId;
+    std::string threadName{};
+    // Set while the owning thread is recording an event
+    std::atomic<bool> isRecording{false};
+
+  private:
+    std::array<Event, CAPACITY> m_events{};
+    std::atomic<uint64_t> m_head{0};
+};
+
+/**
+ * @brief Owns every thread's ring. Rings outlive their threads, so a stopped render thread is still exported
+ */
+struct Registry
+{
+    std::mutex mutex{};
+    std::vector<std::unique_ptr<Ring>> rings{};
+    std::atomic<bool> isEnabled{false};
+    Clock::time_point epoch{Clock::now()};
+};
+
+inline Registry &getRegistry()
+{
+    static Registry registry{};
+    return registry;
+}
+
+// The calling thread's ring, created when it first records an event, so threads only pay for one while
+// tracing is on
+inline Ring *&getThreadRingSlot()
+{
+    thread_local Ring *ring{nullptr};
+    return ring;
+}
+
+// Kept for the ring until the thread records its first event
+inline std::string &getThreadName()
+{
+    thread_local std::string name{};
+    return name;
+}
+
+/**
+ * @brief Get the calling thread's ring, registering it on first use
+ */
+inline Ring &getThreadRing()
+{
+    auto &ring = getThreadRingSlot();
+    if (!ring)
+    {
+        auto &registry = getRegistry();
+        std::lock_guard lock{registry.mutex};
+        auto id = static_cast<uint32_t>(registry.rings.size() + 1);
+        ring = registry.rings.emplace_back(std::make_unique<Ring>(id)).get();
+        ring->threadName = getThreadName();
+    }
+
+    return *ring;
+}
+
+inline void setEnabled(bool isEnabled)
+{
+    getRegistry().isEnabled.store(isEnabled, std::memory_order_relaxed);
+}
+
+inline bool isEnabled()
+{
+    return getRegistry().isEnabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Name the calling thread on the exported timeline
+ */
+inline void nameThread(const char *name)
+{
+    getThreadName() = name;
+    if (auto *ring = getThreadRingSlot())
+    {
+        std::lock_guard lock{getRegistry().mutex};
+        ring->threadName = name;
+    }
+}
+
+/**
+ * @brief Record an event into the calling thread's ring, unless tracing was turned off since the scope began.
+ * The recording flag is raised before the enabled flag is checked, so once an export has turned tracing off
+ * and seen the flag lowered, the thread can't write to its ring until tracing is turned back on
+ */
+inline void record(const Event &event)
+{
+    auto &ring = getThreadRing();
+    ring.isRecording.store(true);
+    if (getRegistry().isEnabled.load())
+        ring.push(event);
+    ring.isRecording.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief Records the time between construction and destruction as a complete event. Does nothing beyond
+ * checking the enabled flag while tracing is off.
+ */
+class Scope
+{
+  public:
+    explicit Scope(const char *name) : m_name(isEnabled() ? name : nullptr)
+    {
+        if (m_name)
+            m_start = Clock::now();
+    }
+
+    ~Scope()
+    {
+        if (!m_name)
+            return;
+
+        auto end = Clock::now();
+        auto toNanos = [](Clock::duration duration) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        };
+        record(Event{m_name, toNanos(m_start - getRegistry().epoch), toNanos(end - m_start)});
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    const char *m_name;
+    Clock::time_point m_start{};
+};
+
+/**
+ * @brief Write every thread's recorded events to a Chrome trace JSON file. Timestamps are in microseconds.
+ * Tracing is paused while the rings are read, and scopes ending meanwhile are dropped.
+ *
+ * @param path - Output file path
+ *
+ * @return bool - Whether the file was written
+ */
+inline bool exportJson(const std::string &path)
+{
+    std::ofstream file{path};
+    if (!file)
+        return false;
+
+    auto &registry = getRegistry();
+    std::lock_guard lock{registry.mutex};
+    bool wasEnabled = registry.isEnabled.exchange(false);
+    for (const auto &ring : registry.rings)
+        while (ring->isRecording.load())
+            std::this_thread::yield();
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    const char *separator = "";
+    for (const auto &ring : registry.rings)
+    {
+        if (!ring->threadName.empty())
+        {
+            file << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId
+                 << ",\"args\":{\"name\":\"" << ring->threadName << "\"}}";
+            separator = ",\n";
+        }
+
+        ring->each([&](const Event &event) {
+            file << separator << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                 << ring->threadId << ",\"ts\":" << event.start / 1000.0
+                 << ",\"dur\":" << event.duration / 1000.0 << "}";
+            separator = ",\n";
+        });
+    }
+
+    file << "\n]}\n";
+    registry.isEnabled.store(wasEnabled);
+
+    return !!file;
+}
+} // namespace Trace
@@ -6,7 +6,7 @@
 // clang-format off
 namespace UI
 {
-inline std::function<EntityId(ComponentManager &cm, float, float, float, float)> getEntityConstructor(char c)
+inline EntityConstructor getEntityConstructor(char c)
 {
     switch (c)
     {
@@ -16,10 +16,10 @@ inline std::function<EntityId(ComponentManager &cm, float, float, float, float)>
         return playerLives;
     }
 
-    return NULL;
+    return nullptr;
 };
 
-const std::vector<std::string_view> ui{
+inline const std::vector<std::string_view> ui{
     " S                        L   ",
     "                              ",
     "                              ",
@@ -44,7 +44,7 @@ const std::vector<std::string_view> ui{
     "                              ",
 };
 
-const std::vector<std::string_view> gameOver{
+inline const std::vector<std::string_view> gameOver{
     "                              ",
     "                              ",
     "    @@@@@ @@@@@ @   @ @@@@    ",
@@ -69,7 +69,7 @@ const std::vector<std::string_view> gameOver{
     "                              ",
 };
 
-inline std::vector<std::string_view> getUI(int _ui)
+inline const std::vector<std::string_view> &getUI(int _ui)
 {
    switch(_ui) 
    {
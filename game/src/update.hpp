@@ -1,10 +1,15 @@
 #pragma once
 
+#include "allocations.hpp"
 #include "components.hpp"
 #include "core.hpp"
+#include "overlay.hpp"
+#include "recycler.hpp"
+#include "resources.hpp"
 #include "systems/ai.hpp"
 #include "systems/attack.hpp"
 #include "systems/collision.hpp"
+#include "systems/combat.hpp"
 #include "systems/damage.hpp"
 #include "systems/death.hpp"
 #include "systems/game.hpp"
@@ -16,15 +21,18 @@
 #include "systems/position.hpp"
 #include "systems/score.hpp"
 #include "systems/ui.hpp"
+#include "telemetry.hpp"
+#include "timers.hpp"
+#include "trace.hpp"
 
-#include <functional>
+#include <chrono>
 
 /**
  * @brief Handles updating all game systems in the correct order, and cleaning up after updates
  */
 namespace Update
 {
-using CleanupFunc = std::function<void(ComponentManager &)>;
+using CleanupFunc = void (*)(ComponentManager &);
 
 /**
  * @brief Run the system cleanup function and clear any components which need clearing
@@ -32,43 +40,94 @@ using CleanupFunc = std::function<void(ComponentManager &)>;
  * @tparam CleanupFuncs - Container of cleanup functions
  *
  * @param clenaupFuncs - Cleanup functions
+ * @param isReplay - Whether the tick is a replayed one, which telemetry has already sampled
  */
-template <typename CleanupFuncs> inline void cleanup(ComponentManager &cm, CleanupFuncs &cleanupFuncs)
+template <typename CleanupFuncs>
+inline void cleanup(ComponentManager &cm, CleanupFuncs &cleanupFuncs, bool isReplay)
 {
+    TRACE_SCOPE("Update::cleanup");
     for (auto &func : cleanupFuncs)
         func(cm);
+    Recycler::flush(cm);
 
+    if (Timers::expire(cm))
+        Utilities::invalidateTransformations(cm);
+
+    if (!isReplay)
+        Telemetry::sample(cm);
     cm.clear<ECS::Tags::Event>();
 }
 
+/**
+ * @brief Run a system's update inside a trace scope named after it, count its allocations, and time it for
+ * the overlay while it is shown
+ *
+ * @param name - Trace event, allocation report and overlay name
+ * @param timings - Overlay timings to record into, or null
+ * @param isReplay - Whether the tick is a replayed one, whose allocations the report has already counted
+ * @param update - Calls the system's update and returns its cleanup function
+ */
+template <typename UpdateFunc>
+inline CleanupFunc runSystem(const char *name, std::vector<Overlay::SystemTiming> *timings, bool isReplay,
+                             UpdateFunc &&update)
+{
+    TRACE_SCOPE(name);
+    using Clock = std::chrono::steady_clock;
+    auto allocations = Allocations::get();
+    auto start = timings ? Clock::now() : Clock::time_point{};
+
+    CleanupFunc cleanupFunc = update();
+
+    if (!isReplay)
+        Allocations::getReport().recordSystem(name, Allocations::get() - allocations);
+    if (timings)
+    {
+        std::chrono::duration<float, std::milli> elapsed = Clock::now() - start;
+        timings->push_back(Overlay::SystemTiming{name, elapsed.count()});
+    }
+
+    return cleanupFunc;
+}
+
 /**
  * @brief Handles updating all systems in order, cleanup, and returns a bool to communicate the game exit
  * state
  *
+ * @param isReplay - Whether a rollback is replaying the tick, which runs the same systems but isn't counted
+ * again in the allocation report, the telemetry samples or the overlay timings
+ *
  * @return bool - Game over state
  */
-inline bool run(ComponentManager &cm)
+inline bool run(ComponentManager &cm, bool isReplay = false)
 {
+    TRACE_SCOPE("Update::run");
+    Resources res = Resources::resolve(cm);
+    Utilities::advanceTransformations(cm);
+    auto *timings = isReplay ? nullptr : Overlay::getSystemTimings(cm);
+
+    auto runOne = [&](const char *name, auto &&update) { return runSystem(name, timings, isReplay, update); };
+
     // clang-format off
-    std::array<CleanupFunc, 14> cleanupFuncs{
-        Systems::AI::update(cm),
-        Systems::Input::update(cm),
-        Systems::Attack::update(cm),
-        Systems::Movement::update(cm),
-        Systems::Position::update(cm),
-        Systems::Collision::update(cm),
-        Systems::Damage::update(cm),
-        Systems::Health::update(cm),
-        Systems::Death::update(cm),
-        Systems::Score::update(cm),
-        Systems::Player::update(cm),
-        Systems::Item::update(cm),
-        Systems::UI::update(cm),
-        Systems::Game::update(cm),
+    std::array<CleanupFunc, 15> cleanupFuncs{
+        runOne("Systems::AI", [&]() { return Systems::AI::update(cm, res); }),
+        runOne("Systems::Input", [&]() { return Systems::Input::update(cm); }),
+        runOne("Systems::Attack", [&]() { return Systems::Attack::update(cm); }),
+        runOne("Systems::Movement", [&]() { return Systems::Movement::update(cm, res); }),
+        runOne("Systems::Position", [&]() { return Systems::Position::update(cm); }),
+        runOne("Systems::Collision", [&]() { return Systems::Collision::update(cm, res); }),
+        runOne("Systems::Combat", [&]() { return Systems::Combat::update(cm, res); }),
+        runOne("Systems::Damage", [&]() { return Systems::Damage::update(cm); }),
+        runOne("Systems::Health", [&]() { return Systems::Health::update(cm); }),
+        runOne("Systems::Death", [&]() { return Systems::Death::update(cm, res); }),
+        runOne("Systems::Score", [&]() { return Systems::Score::update(cm, res); }),
+        runOne("Systems::Player", [&]() { return Systems::Player::update(cm); }),
+        runOne("Systems::Item", [&]() { return Systems::Item::update(cm); }),
+        runOne("Systems::UI", [&]() { return Systems::UI::update(cm); }),
+        runOne("Systems::Game", [&]() { return Systems::Game::update(cm); }),
     };
 
     // clang-format on
-    cleanup(cm, cleanupFuncs);
+    cleanup(cm, cleanupFuncs, isReplay);
 
     auto [gameId, gameComps] = cm.getUnique<GameComponent>();
 
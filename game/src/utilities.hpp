@@ -3,9 +3,17 @@
 #include "components.hpp"
 #include "core.hpp"
 #include "entities.hpp"
+#include "recycler.hpp"
+#include "render_list.hpp"
 #include "renderer.hpp"
 #include "stages.hpp"
+#include "tags.hpp"
+#include "trace.hpp"
 #include "ui.hpp"
+#include "waves.hpp"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <string_view>
 #include <tuple>
 
@@ -14,40 +22,113 @@
  */
 namespace Utilities
 {
+// Each player's inputs for a tick, indexed by the order the players joined in
+using PlayerInputs = std::vector<std::vector<Inputs>>;
+
+/**
+ * @brief Wrap a transformation so its result is computed at most once per entity per frame
+ */
+template <typename T, typename TransformFn>
+inline auto memoizeTransformation(std::shared_ptr<TransformCache<T>> cache, TransformFn transform)
+{
+    return [cache, transform](auto eId, T comp) {
+        if (auto *cached = cache->find(eId))
+            return *cached;
+
+        return cache->store(eId, transform(eId, std::move(comp)));
+    };
+}
 
 /**
  * @brief Single place to register all transformation pipelines
  */
 inline void registerTransformations(ComponentManager &cm)
 {
+    auto movementCache = std::make_shared<TransformCache<MovementComponent>>();
+    auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    cm.add<TransformCacheComponent>(gameId, movementCache);
+
     // Player powerup effect
-    cm.registerTransformation<MovementComponent>([&](auto eId, MovementComponent comp) {
-        auto [projectile] = cm.get<ProjectileComponent>(eId);
-        if (!projectile)
-            return comp;
+    cm.registerTransformation<MovementComponent>(
+        memoizeTransformation(movementCache, [&cm](auto eId, MovementComponent comp) {
+            auto [projectile] = cm.get<ProjectileComponent>(eId);
+            if (!projectile)
+                return comp;
+
+            auto &shooterId = projectile.peek(&ProjectileComponent::shooterId);
+            if (!TagMask::hasAny<PlayerComponent>(cm, shooterId) || !cm.contains<PowerupEffect>(shooterId))
+                return comp;
 
-        auto [playerId, _] = cm.getUnique<PlayerComponent>();
-        auto &shooterId = projectile.peek(&ProjectileComponent::shooterId);
-        if (shooterId != playerId || !cm.contains<PowerupEffect>(playerId))
+            comp.speeds.y += 1000;
             return comp;
+        }));
+}
 
-        comp.speeds.y += 1000;
-        return comp;
-    });
+/**
+ * @brief Start a new frame for the memoized transformations, so values are computed afresh
+ */
+inline void advanceTransformations(ComponentManager &cm)
+{
+    auto [_, transformCacheComps] = cm.getUnique<TransformCacheComponent>();
+    transformCacheComps.mutate(
+        [&](TransformCacheComponent &transformCacheComp) { ++transformCacheComp.movement->frame; });
 }
 
-inline int getTileSize(ComponentManager &cm, const std::vector<std::string_view> &stage)
+/**
+ * @brief Discard memoized transformations after a change to their inputs, eg. a powerup being gained or lost
+ */
+inline void invalidateTransformations(ComponentManager &cm)
 {
-    auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
-    auto &size = gameMetaComps.peek(&GameMetaComponent::screen);
-    return size.x / stage[0].size();
+    auto [_, transformCacheComps] = cm.getUnique<TransformCacheComponent>();
+    transformCacheComps.mutate(
+        [&](TransformCacheComponent &transformCacheComp) { ++transformCacheComp.movement->revision; });
 }
 
 /**
- * @brief Build the game or UI from a template
+ * @brief Get the layout of a template, compiled on first use. Layouts are read-only once compiled, so every
+ * game in the process shares them rather than scanning the template on each stage transition.
  *
  * @tparam ConstructorGetterFn - Function which accepts a char and returns an entity constructor function
  *
+ * @param templ - Reference to a template to build, which must outlive the layout
+ * @param getter - Getter function
+ */
+template <typename ConstructorGetterFn>
+inline const Stages::Layout &getLayout(const std::vector<std::string_view> &templ,
+                                       ConstructorGetterFn &getter)
+{
+    static std::mutex mutex{};
+    static std::unordered_map<const void *, Stages::Layout> layouts{};
+    std::lock_guard lock{mutex};
+    auto [it, isNew] = layouts.try_emplace(&templ);
+    if (!isNew)
+        return it->second;
+
+    auto &layout = it->second;
+    layout.columns = templ[0].size();
+    for (std::size_t row = 0; row < templ.size(); ++row)
+        for (std::size_t col = 0; col < templ[row].size(); ++col)
+            if (auto construct = getter(templ[row][col]))
+                layout.placements.push_back(
+                    Stages::Layout::Placement{construct, static_cast<int>(col), static_cast<int>(row)});
+
+    return layout;
+}
+
+/**
+ * @brief Build the entities a layout places, scaled to fill the screen's width
+ */
+inline void buildFromLayout(ComponentManager &cm, const Stages::Layout &layout)
+{
+    auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    int tileSize = gameMetaComps.peek(&GameMetaComponent::screen).x / layout.columns;
+    for (const auto &placement : layout.placements)
+        placement.construct(cm, placement.col * tileSize, placement.row * tileSize, tileSize, tileSize);
+}
+
+/**
+ * @brief Build the game or UI from a template
+ *
  * @param templ - Reference to a template to build
  * @param getter - Getter function
  */
@@ -55,18 +136,7 @@ template <typename ConstructorGetterFn>
 inline void buildFromTemplate(ComponentManager &cm, const std::vector<std::string_view> &templ,
                               ConstructorGetterFn &getter)
 {
-    auto tileSize = getTileSize(cm, templ);
-    for (int row = 0; row < templ.size(); ++row)
-    {
-        for (int col = 0; col < templ[row].size(); ++col)
-        {
-            auto constructor = getter(templ[row][col]);
-            if (!constructor)
-                continue;
-
-            constructor(cm, col * tileSize, row * tileSize, tileSize, tileSize);
-        }
-    }
+    buildFromLayout(cm, getLayout(templ, getter));
 };
 
 /**
@@ -77,7 +147,7 @@ inline void buildFromTemplate(ComponentManager &cm, const std::vector<std::strin
 inline void initializeGame(ComponentManager &cm, ScreenConfig &screen)
 {
     PRINT("STARTING GAME")
-    auto stage = Stages::getStage(999);
+    auto &stage = Stages::getStage(999);
     float screenW = screen.width;
     float screenH = screen.height;
     Vector2 size{screenW, screenH};
@@ -87,6 +157,58 @@ inline void initializeGame(ComponentManager &cm, ScreenConfig &screen)
     buildFromTemplate(cm, UI::getUI(1), UI::getEntityConstructor);
 };
 
+// Endless runs stop getting harder from this modifier on
+constexpr float MAX_DIFFICULTY_MODIFIER = 5;
+
+/**
+ * @brief Speed and attack rate modifier for a stage, which increases from the third stage on
+ */
+inline float calculateDifficultyModifier(int stage)
+{
+    float modifier = stage / 2.0f;
+    if (modifier < 1)
+        modifier = 1;
+
+    return std::min(modifier, MAX_DIFFICULTY_MODIFIER);
+}
+
+/**
+ * @brief Release what the game's tables indexed by entity id hold for removed entities. Run between stages,
+ * when the most entities have just been removed
+ */
+inline void compactIdTables(ComponentManager &cm)
+{
+    TagMask::compact(cm);
+    auto [_, transformCacheComps] = cm.getUnique<TransformCacheComponent>();
+    transformCacheComps.mutate(
+        [&](TransformCacheComponent &transformCacheComp) { transformCacheComp.movement->compact(); });
+
+    // Every hive has been removed, so none are indexed
+    auto [rosterId, rosterComps] = cm.getUnique<HiveRosterComponent>();
+    rosterComps.mutate([&](HiveRosterComponent &roster) {
+        roster.hiveIndices.clear();
+        roster.hiveIndices.shrink_to_fit();
+    });
+}
+
+/**
+ * @brief Build a stage. In endless runs every stage after the fixed ones is a generated wave
+ */
+inline void buildStage(ComponentManager &cm, int stage)
+{
+    auto [_, waveComps] = cm.getUnique<WaveComponent>();
+    if (!waveComps || stage <= Stages::LAST_STAGE)
+    {
+        buildFromTemplate(cm, Stages::getStage(stage), Stages::getEntityConstructor);
+        return;
+    }
+
+    Stages::Layout layout{};
+    int wave = stage - Stages::LAST_STAGE;
+    waveComps.inspect([&](const WaveComponent &waveComp) { Waves::generate(waveComp, wave, layout); });
+    buildFromLayout(cm, layout);
+}
+
 /**
  * @brief handles necessary current stage clearing and building of the next stage
  *
@@ -94,16 +216,45 @@ inline void initializeGame(ComponentManager &cm, ScreenConfig &screen)
  */
 inline void goToStage(ComponentManager &cm, int stage)
 {
+    TRACE_SCOPE("Utilities::goToStage");
     PRINT("STAGE:", stage, "LOADED")
-    cm.clear<HiveMovementEffect>();
-    cm.remove(cm.getEntityIds<HiveAIComponent>());
-    buildFromTemplate(cm, Stages::getStage(stage), Stages::getEntityConstructor);
+    Recycler::destroy(cm, cm.getEntityIds<HiveAIComponent>());
+    Recycler::destroy(cm, cm.getEntityIds<HiveComponent>());
+    compactIdTables(cm);
+    buildStage(cm, stage);
+    RenderList::markStale(cm);
 };
 
+/**
+ * @brief Skip the title page and start the game at a stage
+ */
+inline void startAtStage(ComponentManager &cm, int stage)
+{
+    auto [_, gameComps] = cm.getUnique<GameComponent>();
+    gameComps.mutate([&](GameComponent &gameComp) {
+        gameComp.currentStage = stage;
+        gameComp.difficultyModifier = calculateDifficultyModifier(stage);
+    });
+    goToStage(cm, stage);
+    Recycler::destroy(cm, cm.getEntityIds<TitleScreenComponent>());
+};
+
+/**
+ * @brief Set the time step for the next update, and advance the simulation clock by it
+ */
 inline void setDeltaTime(ComponentManager &cm, float delta)
 {
     auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
-    gameMetaComps.mutate([&](GameMetaComponent &gameMetaComp) { gameMetaComp.deltaTime = delta; });
+    gameMetaComps.mutate([&](GameMetaComponent &gameMetaComp) {
+        gameMetaComp.deltaTime = delta;
+        gameMetaComp.simTime += delta;
+    });
+};
+
+inline void setFusedCombat(ComponentManager &cm, bool isFused)
+{
+    auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    gameMetaComps.mutate([&](GameMetaComponent &gameMetaComp) { gameMetaComp.fusedCombat = isFused; });
 };
 
 inline float getDeltaTime(ComponentManager &cm)
@@ -112,6 +263,12 @@ inline float getDeltaTime(ComponentManager &cm)
     return gameMetaComps.peek(&GameMetaComponent::deltaTime);
 };
 
+inline double getSimTime(ComponentManager &cm)
+{
+    auto [gameId, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    return gameMetaComps.peek(&GameMetaComponent::simTime);
+};
+
 inline bool containsId(const auto &vec, EntityId id)
 {
     for (const auto &vecId : vec)
@@ -121,9 +278,28 @@ inline bool containsId(const auto &vec, EntityId id)
     return false;
 }
 
-inline void registerPlayerInputs(ComponentManager &cm, std::vector<Inputs> &inputs)
+/**
+ * @brief Get a player's id by the order they joined in, or 0 if there is no such player. Matched on the
+ * player's own index, as the order players are stored in changes when one is removed or an id is reused
+ */
+inline EntityId getPlayerId(ComponentManager &cm, std::size_t player)
 {
-    auto [playerId, _] = cm.getUnique<PlayerComponent>();
+    for (const auto &playerId : cm.getEntityIds<PlayerComponent>())
+    {
+        auto [playerComps] = cm.get<PlayerComponent>(playerId);
+        if (playerComps.peek(&PlayerComponent::index) == player)
+            return playerId;
+    }
+
+    return 0;
+}
+
+inline void registerPlayerInputs(ComponentManager &cm, const std::vector<Inputs> &inputs, std::size_t player)
+{
+    auto playerId = getPlayerId(cm, player);
+    if (!playerId)
+        return;
+
     using Movements = decltype(PlayerInputEvent::movement);
     using Actions = decltype(PlayerInputEvent::action);
     for (const auto &input : inputs)
@@ -145,60 +321,102 @@ inline void registerPlayerInputs(ComponentManager &cm, std::vector<Inputs> &inpu
         case Inputs::UP:
         case Inputs::DOWN:
         case Inputs::MENU:
+        case Inputs::TRACE:
+        case Inputs::OVERLAY:
+        case Inputs::SAVE:
+        case Inputs::LOAD:
         default:
             break;
         }
     }
 };
 
+inline void registerPlayerInputs(ComponentManager &cm, const PlayerInputs &inputs)
+{
+    for (std::size_t player = 0; player < inputs.size(); ++player)
+        registerPlayerInputs(cm, inputs[player], player);
+}
+
 /**
- * @brief Creates renderable elements, separated by non-UI and UI components.
+ * @brief Add scripted inputs which sweep the player back and forth while shooting, so runs without a player
+ * still progress through the game deterministically
  *
- * @return Container of rendereable elements
- */
-inline std::vector<Renderer::RenderableElement> getRenderableElements(ComponentManager &cm)
-{
-    std::vector<Renderer::RenderableElement> worldElements{};
-    std::vector<Renderer::RenderableElement> uiElements{};
-
-    cm.getGroup<SpriteComponent, PositionComponent>().each(
-        [&](EId eId, auto &spriteComps, auto &positionComps) {
-            auto &rgba = spriteComps.peek(&SpriteComponent::rgba);
-            auto [x, y, w, h] = positionComps.peek(&PositionComponent::bounds).get();
-            Renderer::RenderableElement renderEl{x, y, w, h, rgba};
-            auto isUIComps = cm.contains<UIComponent>(eId);
-            auto &vec = isUIComps ? uiElements : worldElements;
-            if (isUIComps)
-            {
-                auto [textComps] = cm.get<TextComponent>(eId);
-                textComps.inspect([&](const TextComponent &textComp) {
-                    renderEl.text = textComp.text;
-                    renderEl.rgba = Renderer::RGBA{255, 255, 255, 255};
-                });
-            }
-
-            vec.push_back(std::move(renderEl));
-        });
-
-    // UI elements are last to ensure they are overlaid on top
-    worldElements.insert(worldElements.end(), uiElements.begin(), uiElements.end());
-    return worldElements;
-};
+ * @param cycle - Current frame
+ * @param player - Players after the first sweep out of step with it, so they spread out
+ */
+inline void addAutopilotInputs(std::vector<Inputs> &inputs, int cycle, std::size_t player = 0)
+{
+    constexpr int SWEEP_FRAMES = 240;
+    cycle += static_cast<int>(player) * SWEEP_FRAMES / 3;
+    inputs.push_back(Inputs::SHOOT);
+    inputs.push_back((cycle / SWEEP_FRAMES) % 2 ? Inputs::LEFT : Inputs::RIGHT);
+}
 
 /**
- * @brief Iterate over each component set and cleanup and expired effects
+ * @brief Set the inputs of every player after the first from the autopilot, standing in for remote players
+ */
+inline void addBotInputs(PlayerInputs &inputs, int cycle)
+{
+    for (std::size_t player = 1; player < inputs.size(); ++player)
+    {
+        inputs[player].clear();
+        addAutopilotInputs(inputs[player], cycle, player);
+    }
+}
+
+/**
+ * @brief Add players until there are the given number, spread out along the first player's row, each with
+ * score and lives cards on their own row of the UI below the first player's
+ */
+inline void joinPlayers(ComponentManager &cm, int players)
+{
+    auto firstId = getPlayerId(cm, 0);
+    auto [firstComps] = cm.get<PlayerComponent>(firstId);
+    if (!firstComps)
+        return;
+
+    auto [_, gameMetaComps] = cm.getUnique<GameMetaComponent>();
+    auto &screen = gameMetaComps.peek(&GameMetaComponent::screen);
+    float tileSize = gameMetaComps.peek(&GameMetaComponent::tileSize);
+
+    // Undo the offsets the player constructor applies, to place players like the template does
+    auto [positionComps] = cm.get<PositionComponent>(firstId);
+    auto &bounds = positionComps.peek(&PositionComponent::bounds);
+    float x = bounds.position.x + tileSize / 4;
+    float y = bounds.position.y - tileSize / 2;
+
+    auto [scoreCardId, lifeCardId] =
+        firstComps.peek(&PlayerComponent::scoreCardId, &PlayerComponent::lifeCardId);
+    auto [scoreCardComps] = cm.get<PositionComponent>(scoreCardId);
+    auto [lifeCardComps] = cm.get<PositionComponent>(lifeCardId);
+    for (auto index = cm.getEntityIds<PlayerComponent>().size(); index < static_cast<std::size_t>(players);
+         ++index)
+    {
+        float offset = index * (screen.x / players);
+        player(cm, std::fmod(x + offset, screen.x - tileSize), y, tileSize, tileSize);
+        if (scoreCardComps)
+        {
+            auto [cX, cY] = scoreCardComps.peek(&PositionComponent::bounds).position;
+            playerScore(cm, cX, cY + index * tileSize, tileSize, tileSize);
+        }
+        if (lifeCardComps)
+        {
+            auto [cX, cY] = lifeCardComps.peek(&PositionComponent::bounds).position;
+            playerLives(cm, cX, cY + index * tileSize, tileSize, tileSize);
+        }
+    }
+}
+
+/**
+ * @brief Iterate over each component set and remove effects flagged for cleanup.  Timed effects are
+ * removed as they expire by Timers::expire
  */
 template <typename... Ts> inline void cleanupEffect(ComponentManager &cm)
 {
     std::apply(
         [&](auto &...set) {
             (set.each([&](EId eId, auto &effects) {
-                effects.remove([&](auto &effect) {
-                    if (effect.timer.has_value() && effect.timer->hasElapsed())
-                        return true;
-
-                    return effect.cleanup;
-                });
+                effects.remove([&](auto &effect) { return effect.cleanup; });
             }),
              ...);
         },
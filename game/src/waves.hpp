@@ -0,0 +1,246 @@
+#pragma once
+
+#include "allocations.hpp"
+#include "components.hpp"
+#include "core.hpp"
+#include "entities.hpp"
+#include "random.hpp"
+#include "recycler.hpp"
+#include "stages.hpp"
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Endless runs generate every stage after the fixed ones as a wave of hives, so soak runs can play an
+ * unbounded sequence of stages. A wave only depends on the seed, the settings and its number, so every run
+ * with the same seed meets the same waves, however it got to them.
+ */
+namespace Waves
+{
+// Generated waves are laid out on the same grid as the fixed stages
+constexpr std::size_t COLUMNS = 30;
+// Tiles aliens may start on, leaving room below for the players
+constexpr int FIRST_ROW = 2;
+constexpr int LAST_ROW = 12;
+constexpr int FIRST_COLUMN = 2;
+constexpr int LAST_COLUMN = 27;
+// Hives are laid out in bands, at most this many side by side
+constexpr int BAND_COLUMNS = 3;
+constexpr int MAX_HIVES = BAND_COLUMNS * (LAST_ROW - FIRST_ROW + 1);
+
+/**
+ * @brief Turn on the wave generator with the run's wave settings. Each wave has between 1 and the configured
+ * number of hives
+ */
+inline void enable(ComponentManager &cm, const RunConfig &config)
+{
+    auto [gameId, _] = cm.getUnique<GameComponent>();
+    cm.add<WaveComponent>(gameId, config.waveSeed, std::clamp(config.waveDensity, 0.0f, 1.0f),
+                          std::clamp(config.waveHives, 1, MAX_HIVES));
+    // Soak runs create entities for long enough that the id space has to be reused
+    Recycler::enable(cm);
+}
+
+/**
+ * @brief Get the generator state for a wave, mixed from the seed and the wave number
+ */
+inline uint64_t getWaveState(uint64_t seed, int wave)
+{
+    uint64_t state = seed + static_cast<uint64_t>(wave) * 0x9E3779B97F4A7C15ull;
+    state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ull;
+    state = (state ^ (state >> 27)) * 0x94D049BB133111EBull;
+    state ^= state >> 31;
+
+    return state ? state : 1;
+}
+
+inline EntityConstructor getAlienConstructor(int row, int top, int height)
+{
+    int third = (row - top) * 3 / std::max(1, height);
+    return third == 0 ? hiveAlienSmall : third == 1 ? hiveAlienMedium : hiveAlienLarge;
+}
+
+/**
+ * @brief Generate a wave's layout. Each hive takes a band of the alien area, with small aliens in its top
+ * rows and large ones in its bottom rows, and every other tile of the band filled by the density
+ *
+ * @param wave - Wave number, from 1
+ * @param layout - Filled with the wave, reusing its memory
+ */
+inline void generate(const WaveComponent &waveComp, int wave, Stages::Layout &layout)
+{
+    layout.placements.clear();
+    layout.columns = COLUMNS;
+    auto state = getWaveState(waveComp.seed, wave);
+    int hives = 1 + Random::next(state) % waveComp.hives;
+    int bandColumns = std::min(hives, BAND_COLUMNS);
+    int bandRows = (hives + bandColumns - 1) / bandColumns;
+    int bandWidth = (LAST_COLUMN - FIRST_COLUMN + 1) / bandColumns;
+    int bandHeight = (LAST_ROW - FIRST_ROW + 1) / bandRows;
+    auto threshold = static_cast<int>(waveComp.density * 1000);
+
+    for (int band = 0; band < hives; ++band)
+    {
+        int left = FIRST_COLUMN + (band % bandColumns) * bandWidth;
+        int top = FIRST_ROW + (band / bandColumns) * bandHeight;
+        // Aliens join the newest hive, so each hive is placed before its aliens
+        layout.placements.push_back(Stages::Layout::Placement{hive, left, top});
+        auto first = layout.placements.size();
+        for (int row = top; row < top + bandHeight; row += 2)
+            for (int col = left + 1; col < left + bandWidth - 1; col += 2)
+                if (Random::next(state) % 1000 < threshold)
+                    layout.placements.push_back(
+                        Stages::Layout::Placement{getAlienConstructor(row, top, bandHeight), col, row});
+
+        if (layout.placements.size() == first)
+            layout.placements.push_back(Stages::Layout::Placement{hiveAlienSmall, left + 1, top});
+    }
+}
+
+/**
+ * @brief Bytes held by the game's tables indexed by entity id, which grow to the highest id in use
+ */
+inline uint64_t getIdTableBytes(ComponentManager &cm)
+{
+    uint64_t bytes{};
+    auto [tagMaskId, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+    bytes += tagMaskComps.peek(&TagMaskComponent::masks).capacity() * sizeof(uint32_t);
+
+    auto [transformCacheId, transformCacheComps] = cm.getUnique<TransformCacheComponent>();
+    if (transformCacheComps)
+    {
+        auto &entries = transformCacheComps.peek(&TransformCacheComponent::movement)->entries;
+        bytes += entries.capacity() * sizeof(entries[0]);
+    }
+
+    auto [rosterId, rosterComps] = cm.getUnique<HiveRosterComponent>();
+    auto &hiveIndices = rosterComps.peek(&HiveRosterComponent::hiveIndices);
+    bytes += hiveIndices.capacity() * sizeof(hiveIndices[0]);
+
+    return bytes;
+}
+
+/**
+ * @brief Checks that memory stays flat over an endless run. Each generated wave is sampled as it starts, and
+ * the last sample is compared with the first after a few warm up waves: the entities carried over from the
+ * waves before, the id limit the id indexed tables grow to, those tables' bytes and the resident memory.
+ *
+ * Endless runs recycle the ids of destroyed entities, but ids are only released at the end of a frame, and a
+ * stage change destroys the old wave in the same frame it builds the new one. The id limit so grows with the
+ * most ids held at once, which is the entities alive plus the wave destroyed as the next one starts, and
+ * random wave sizes set a new most now and then. Ids are leaked when the limit grows faster than that, or
+ * grows at wave after wave: an entity was removed without Recycler::destroy, and its id is never reused.
+ */
+class LeakCheck
+{
+  public:
+    // Waves which are played before the first compared sample, while pools and buffers grow to fit
+    static constexpr int WARMUP_WAVES = 3;
+    // Growth tolerated over the first compared sample, other than for the id limit
+    static constexpr double TOLERANCE = 0.25;
+    // Projectiles, UFOs and powerups which can be in flight as a wave starts
+    static constexpr uint32_t ENTITY_SLACK = 32;
+    // Ids held by entities created and destroyed within a frame, which the live count never sees
+    static constexpr std::size_t ID_SLACK = 32;
+    // Waves in a row the id limit can grow at before it is a leak, however little it grows each time
+    static constexpr int ID_GROWTH_WAVES = 8;
+
+    /**
+     * @brief Track the most ids held at once, and sample the world if a generated wave started this frame
+     */
+    void sample(ComponentManager &cm, uint64_t frame)
+    {
+        auto entities = Recycler::getEntityCount(cm);
+        m_peakIds = std::max<std::size_t>(m_peakIds, entities);
+
+        auto [_, gameComps] = cm.getUnique<GameComponent>();
+        auto &stage = gameComps.peek(&GameComponent::currentStage);
+        if (stage == m_stage)
+            return;
+
+        m_stage = stage;
+        if (stage <= Stages::LAST_STAGE)
+            return;
+
+        // The last wave was destroyed this frame, so its ids were still held as this wave was built
+        auto [tagMaskId, tagMaskComps] = cm.getUnique<TagMaskComponent>();
+        auto waveEntities =
+            cm.getEntityIds<HiveAIComponent>().size() + cm.getEntityIds<HiveComponent>().size();
+        m_peakIds = std::max(m_peakIds, entities + m_waveEntities);
+        m_waveEntities = waveEntities;
+
+        Sample sample{stage - Stages::LAST_STAGE,
+                      frame,
+                      entities - static_cast<uint32_t>(waveEntities),
+                      tagMaskComps.peek(&TagMaskComponent::masks).size(),
+                      m_peakIds,
+                      getIdTableBytes(cm),
+                      Allocations::getResidentBytes()};
+
+        m_idGrowthWaves = sample.idLimit > m_last.idLimit ? m_idGrowthWaves + 1 : 0;
+        m_mostIdGrowthWaves = std::max(m_mostIdGrowthWaves, m_waves >= WARMUP_WAVES ? m_idGrowthWaves : 0);
+        if (++m_waves == WARMUP_WAVES)
+            m_first = sample;
+        m_last = sample;
+    }
+
+    void printReport() const
+    {
+        if (!m_waves)
+            return;
+
+        PRINT("waves:", m_waves, "generated waves played, the last was wave", m_last.wave)
+        if (m_waves <= WARMUP_WAVES)
+        {
+            PRINT("WAVE LEAK CHECK NEEDS MORE THAN", WARMUP_WAVES, "WAVES")
+            return;
+        }
+
+        double waves = m_last.wave - m_first.wave;
+        PRINT("waves: compared wave", m_first.wave, "at frame", m_first.frame, "with wave", m_last.wave,
+              "at frame", m_last.frame)
+        PRINT("waves: entities carried over", m_first.carried, "->", m_last.carried, ", id limit",
+              m_first.idLimit, "->", m_last.idLimit, ",", (m_last.idLimit - double(m_first.idLimit)) / waves,
+              "ids per wave, most ids held at once", m_first.peakIds, "->", m_last.peakIds)
+        PRINT("waves: id table bytes", m_first.tableBytes, "->", m_last.tableBytes, ", resident bytes",
+              m_first.resident, "->", m_last.resident)
+
+        bool isEntityLeak = m_last.carried > m_first.carried * (1 + TOLERANCE) + ENTITY_SLACK;
+        bool isIdGrowth = m_last.idLimit > m_first.idLimit + (m_last.peakIds - m_first.peakIds) + ID_SLACK ||
+                          m_mostIdGrowthWaves >= ID_GROWTH_WAVES;
+        bool isTableGrowth = m_last.tableBytes > m_first.tableBytes * (1 + TOLERANCE);
+        bool isResidentGrowth = m_last.resident > m_first.resident * (1 + TOLERANCE);
+        if (isEntityLeak)
+            PRINT("WAVE LEAK CHECK: ENTITIES ARE LEFT BEHIND BY EACH WAVE")
+        if (isIdGrowth)
+            PRINT("WAVE LEAK CHECK: ENTITY IDS ARE LEAKED")
+        if (isTableGrowth)
+            PRINT("WAVE LEAK CHECK: ID INDEXED TABLES GROW WITH EACH WAVE")
+        if (isResidentGrowth)
+            PRINT("WAVE LEAK CHECK: RESIDENT MEMORY GROWS WITH EACH WAVE")
+        if (!isEntityLeak && !isIdGrowth && !isTableGrowth && !isResidentGrowth)
+            PRINT("WAVE LEAK CHECK PASSED OVER", waves, "WAVES")
+    }
+
+  private:
+    struct Sample
+    {
+        int wave{};
+        uint64_t frame{};
+        uint32_t carried{};
+        std::size_t idLimit{};
+        std::size_t peakIds{};
+        uint64_t tableBytes{};
+        uint64_t resident{};
+    };
+
+    Sample m_first{};
+    Sample m_last{};
+    int m_stage{};
+    int m_waves{};
+    std::size_t m_peakIds{};
+    std::size_t m_waveEntities{};
+    int m_idGrowthWaves{};
+    int m_mostIdGrowthWaves{};
+};
+} // namespace Waves